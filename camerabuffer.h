@@ -0,0 +1,74 @@
+#ifndef CAMERABUFFER_H_INCLUDED
+#define CAMERABUFFER_H_INCLUDED
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Matches the std140 "Camera" uniform block of the shaders. Every program
+// using the block reads the same buffer through binding point BINDING, so the
+// matrices are uploaded once however many programs draw with them.
+class CameraBuffer {
+public:
+    static const GLuint BINDING = 0;
+
+    CameraBuffer(): m_dirty(true) {
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, m_buffer);
+    }
+
+    ~CameraBuffer() {
+        glDeleteBuffers(1, &m_buffer);
+    }
+
+    // GLSL 330 has no layout(binding), so every program is pointed at the binding point after linking
+    static void bindProgram(GLuint program) {
+        GLuint index = glGetUniformBlockIndex(program, "Camera");
+        if(index != GL_INVALID_INDEX) glUniformBlockBinding(program, index, BINDING);
+    }
+
+    void setView(const glm::mat4& view) {
+        m_block.view = view;
+        m_dirty = true;
+    }
+
+    void setProjection(const glm::mat4& projection) {
+        m_block.projection = projection;
+        m_dirty = true;
+    }
+
+    const glm::mat4& getView() const { return m_block.view; }
+    const glm::mat4& getProjection() const { return m_block.projection; }
+    const glm::mat4& getViewProjection() const { return m_block.viewProjection; }
+
+    // Uploads the matrices if they changed since the last call; call before drawing
+    void update() {
+        if(!m_dirty) return;
+
+        m_block.viewProjection = m_block.projection * m_block.view;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &m_block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        m_dirty = false;
+    }
+
+private:
+    // mat4 columns are vec4s, so the std140 layout is the tightly packed one
+    struct Block {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 viewProjection;
+    };
+
+    GLuint m_buffer;
+    Block m_block;
+    bool m_dirty;
+};
+
+#endif // CAMERABUFFER_H_INCLUDED
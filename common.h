@@ -1,6 +1,10 @@
 #ifndef COMMON_H_INCLUDED
 #define COMMON_H_INCLUDED
 
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
 namespace Constants {
     const float SCREEN_WIDTH = 1080;
     const float SCREEN_HEIGHT = 720;
@@ -11,7 +15,32 @@ namespace Constants {
     const float CELL_WIDTH = 1.0f;
 
     const int MAX_APPLES_COUNT = 5;
-    const float APPLE_SPAWN_CHANCE = 0.5f;
+    const float APPLE_SPAWN_CHANCE = 9.0f; // percent per tick
+
+    // Simulation ticks per second while the renderer runs on its own thread
+    const float SIMULATION_RATE = 120.0f;
+}
+
+// Indices first to last, both included
+struct IndexRange {
+    std::size_t first;
+    std::size_t last;
+};
+
+// Adds range to ranges kept ascending, merging it with every range it overlaps or touches
+inline void addIndexRange(std::vector<IndexRange>& ranges, IndexRange range) {
+    std::size_t i = 0;
+    while(i < ranges.size() && ranges[i].last + 1 < range.first) i++;
+
+    std::size_t end = i;
+    while(end < ranges.size() && ranges[end].first <= range.last + 1) {
+        range.first = std::min(range.first, ranges[end].first);
+        range.last = std::max(range.last, ranges[end].last);
+        end++;
+    }
+
+    ranges.erase(ranges.begin() + i, ranges.begin() + end);
+    ranges.insert(ranges.begin() + i, range);
 }
 
 #endif // COMMON_H_INCLUDED
@@ -6,30 +6,105 @@
 
 #include <vector>
 
+#include "common.h"
+#include "snakebody.h"
+
 using std::vector;
 
 enum Direction {
     LEFT, TOP, RIGHT, BOTTOM
 };
 
-glm::vec3 directionToVector(Direction direction) {
+// The step of a move in cells
+glm::ivec3 directionToVector(Direction direction) {
     switch(direction) {
-    case LEFT: return glm::vec3(1.0f, 0.0f, 0.0f);
-    case TOP: return glm::vec3(0.0f, 0.0f, -1.0f);
-    case RIGHT: return glm::vec3(-1.0f, 0.0f, 0.0f);
-    case BOTTOM: return glm::vec3(0.0f, 0.0f, 1.0f);
+    case LEFT: return glm::ivec3(1, 0, 0);
+    case TOP: return glm::ivec3(0, 0, -1);
+    case RIGHT: return glm::ivec3(-1, 0, 0);
+    case BOTTOM: return glm::ivec3(0, 0, 1);
     }
 
-    return glm::vec3(0.0f, 0.0f, 0.0f);
+    return glm::ivec3(0, 0, 0);
 }
 
+// Which segments of a snake changed since the changes were last taken, so the
+// renderer can patch its copy instead of copying the whole body. Ranges are
+// kept in the current indices: shift() moves the ones already recorded along
+// with the body.
+struct SegmentChanges {
+    unsigned long shifts = 0;  // times every segment moved one index up to make room for a new head
+    vector<IndexRange> dirty;  // ascending, neither overlapping nor adjacent
+
+    bool empty() const { return shifts == 0 && dirty.empty(); }
+
+    void clear() {
+        shifts = 0;
+        dirty.clear();
+    }
+
+    void markDirty(std::size_t index) { markDirty(IndexRange{index, index}); }
+
+    void markDirty(IndexRange range) { addIndexRange(dirty, range); }
+
+    void shift() {
+        shifts++;
+        for(IndexRange& range : dirty) {
+            range.first++;
+            range.last++;
+        }
+    }
+
+    // Adds changes made after these
+    void append(const SegmentChanges& later) {
+        for(IndexRange& range : dirty) {
+            range.first += later.shifts;
+            range.last += later.shifts;
+        }
+        shifts += later.shifts;
+
+        for(const IndexRange& range : later.dirty) markDirty(range);
+    }
+};
+
+// Lives on whole cells and moves a cell per simulation tick; the renderer
+// slides the head and the tail between their last two cells.
 struct Snake {
-    Snake(glm::vec3 position, Direction direction, float spd): movingDirection(direction), speed(spd) {
-        parts.push_back(position);
-        parts.push_back(position);
+    Snake(glm::ivec3 cell, Direction direction, float spd): previousTail(cell), growth(0), movingDirection(direction), speed(spd) {
+        parts.pushBack(cell);
+        parts.pushBack(cell);
+        changes.markDirty(IndexRange{0, 1});
+    }
+
+    // The snake is a segment longer after the next move
+    void grow() {
+        growth++;
     }
 
-    vector<glm::vec3> parts;
+    // Moves the head on to cell. The tail is dropped unless growing, every other segment stays where it
+    // is. Returns whether the tail was dropped.
+    bool advance(glm::ivec3 cell) {
+        parts.pushFront(cell);
+
+        bool dropped = growth == 0;
+        previousTail = parts.back();
+        if(dropped) parts.popBack();
+        else growth--;
+
+        changes.shift();
+        changes.markDirty(IndexRange{0, 1});
+        return dropped;
+    }
+
+    SnakeBody parts;
+
+    // Where the tail was before the last move, the same cell when it grew
+    glm::ivec3 previousTail;
+
+    // Moves left that keep the tail
+    unsigned int growth;
+
+    // Every write to parts is recorded here
+    SegmentChanges changes;
 
     Direction movingDirection;
 
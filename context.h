@@ -0,0 +1,290 @@
+#ifndef CONTEXT_H_INCLUDED
+#define CONTEXT_H_INCLUDED
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "framepacer.h"
+
+// Owns the GL context and the surface frames end up on
+class IContext {
+public:
+    virtual ~IContext() { }
+
+    virtual bool isValid() const = 0;
+    virtual GLADloadproc getProcLoader() = 0;
+
+    virtual bool shouldClose() = 0;
+    virtual void requestClose() = 0;
+    virtual void swapBuffers() = 0;
+    virtual void pollEvents() { }
+    virtual double getTime() = 0;
+
+    // Called once GL functions are loaded
+    virtual void initGL() { }
+
+    // Follows the framebuffer size with the viewport; call on the thread the context is current on, before drawing
+    virtual void updateViewport() { }
+
+    // The context is current on at most one thread; release it before making it current on another
+    virtual bool makeCurrent() = 0;
+    virtual void releaseCurrent() = 0;
+
+    // Applies to the context current on the calling thread; false when the mode isn't available
+    virtual bool setPresentMode(PresentMode mode) { return false; }
+
+    // NULL when there is no window to read input from
+    virtual GLFWwindow* getWindow() { return NULL; }
+
+    virtual int getWidth() const = 0;
+    virtual int getHeight() const = 0;
+
+    // Writes the framebuffer currently bound for drawing as a binary PPM
+    bool captureFrame(const std::string& path) {
+        int width = getWidth(), height = getHeight();
+        std::vector<unsigned char> pixels(width * height * 3);
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if(file == NULL) {
+            std::cout << "Unable to open " << path << " for the frame capture!\n";
+            return false;
+        }
+
+        std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+        for(int y = height - 1; y >= 0; y--) {
+            std::fwrite(&pixels[y * width * 3], 1, width * 3, file);
+        }
+        std::fclose(file);
+
+        return true;
+    }
+};
+
+class WindowContext: public IContext {
+public:
+    WindowContext(const char* title, int width, int height): m_width(width), m_height(height), m_resized(false) {
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        m_pwindow = glfwCreateWindow(width, height, title, NULL, NULL);
+        if(m_pwindow == NULL) {
+            std::cout << "Unable to create window!\n";
+            glfwTerminate();
+            return;
+        }
+        glfwMakeContextCurrent(m_pwindow);
+        readFramebufferSize();
+    }
+
+    ~WindowContext() {
+        glfwTerminate();
+    }
+
+    bool isValid() const { return m_pwindow != NULL; }
+    GLADloadproc getProcLoader() { return (GLADloadproc)glfwGetProcAddress; }
+
+    bool makeCurrent() { glfwMakeContextCurrent(m_pwindow); return true; }
+    void releaseCurrent() { glfwMakeContextCurrent(NULL); }
+
+    bool setPresentMode(PresentMode mode) {
+        int interval = mode == PRESENT_IMMEDIATE ? 0 : 1;
+        if(mode == PRESENT_ADAPTIVE) {
+            if(!glfwExtensionSupported("GLX_EXT_swap_control_tear") && !glfwExtensionSupported("WGL_EXT_swap_control_tear")) {
+                std::cout << "Unable to use adaptive vsync, falling back to vsync!\n";
+                glfwSwapInterval(1);
+                return false;
+            }
+            interval = -1;
+        }
+
+        glfwSwapInterval(interval);
+        return true;
+    }
+
+    bool shouldClose() { return glfwWindowShouldClose(m_pwindow); }
+    void requestClose() { glfwSetWindowShouldClose(m_pwindow, true); }
+    void swapBuffers() { glfwSwapBuffers(m_pwindow); }
+    void pollEvents() {
+        glfwPollEvents();
+        readFramebufferSize();
+    }
+    double getTime() { return glfwGetTime(); }
+
+    GLFWwindow* getWindow() { return m_pwindow; }
+
+    void updateViewport() {
+        if(m_resized.exchange(false)) glViewport(0, 0, m_width, m_height);
+    }
+
+    // The size as of the last pollEvents, so the render thread can ask too
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+
+private:
+    // GLFW only answers on the main thread
+    void readFramebufferSize() {
+        int width, height;
+        glfwGetFramebufferSize(m_pwindow, &width, &height);
+        if(width == m_width && height == m_height) return;
+
+        m_width = width;
+        m_height = height;
+        m_resized = true;
+    }
+
+    GLFWwindow* m_pwindow;
+    std::atomic<int> m_width, m_height;
+    std::atomic<bool> m_resized;
+};
+
+// Surfaceless EGL context (Mesa's llvmpipe works without any display) rendering into an FBO
+class HeadlessContext: public IContext {
+public:
+    HeadlessContext(int width, int height):
+        m_display(EGL_NO_DISPLAY), m_context(EGL_NO_CONTEXT), m_surface(EGL_NO_SURFACE),
+        m_framebuffer(0), m_width(width), m_height(height), m_closeRequested(false) {
+
+        m_startTime = std::chrono::steady_clock::now();
+
+        if(!createContext()) {
+            std::cout << "Unable to create headless EGL context!\n";
+            destroyContext();
+        }
+    }
+
+    ~HeadlessContext() {
+        if(m_framebuffer != 0) {
+            glDeleteFramebuffers(1, &m_framebuffer);
+            glDeleteRenderbuffers(2, m_renderbuffers);
+        }
+        destroyContext();
+    }
+
+    bool isValid() const { return m_context != EGL_NO_CONTEXT; }
+    GLADloadproc getProcLoader() { return (GLADloadproc)eglGetProcAddress; }
+
+    void initGL() {
+        glGenFramebuffers(1, &m_framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+        glGenRenderbuffers(2, m_renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderbuffers[0]);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_renderbuffers[1]);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Headless framebuffer is incomplete!\n";
+        }
+
+        glViewport(0, 0, m_width, m_height);
+    }
+
+    bool makeCurrent() { return eglMakeCurrent(m_display, m_surface, m_surface, m_context); }
+    void releaseCurrent() { eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT); }
+
+    bool shouldClose() { return m_closeRequested; }
+    void requestClose() { m_closeRequested = true; }
+    void swapBuffers() { glFlush(); }
+
+    double getTime() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+    }
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+
+private:
+    bool createContext() {
+        const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if(clientExtensions != NULL && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != NULL) {
+            PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+                (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+            if(getPlatformDisplay != NULL) {
+                m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+            }
+        }
+        if(m_display == EGL_NO_DISPLAY) {
+            m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+
+        if(m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, NULL, NULL)) return false;
+        if(!eglBindAPI(EGL_OPENGL_API)) return false;
+
+        const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLConfig config = NULL;
+        EGLint configCount = 0;
+        eglChooseConfig(m_display, configAttributes, &config, 1, &configCount);
+
+        const char* extensions = eglQueryString(m_display, EGL_EXTENSIONS);
+        bool noConfig = extensions != NULL && std::strstr(extensions, "EGL_KHR_no_config_context") != NULL;
+        bool surfaceless = extensions != NULL && std::strstr(extensions, "EGL_KHR_surfaceless_context") != NULL;
+        if(configCount == 0 && !noConfig) return false;
+
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        m_context = eglCreateContext(m_display, configCount > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+        if(m_context == EGL_NO_CONTEXT) return false;
+
+        // Everything is drawn into our own FBO, the surface only exists to make the context current
+        if(!surfaceless) {
+            const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+            m_surface = eglCreatePbufferSurface(m_display, config, surfaceAttributes);
+        }
+
+        return eglMakeCurrent(m_display, m_surface, m_surface, m_context);
+    }
+
+    void destroyContext() {
+        if(m_display == EGL_NO_DISPLAY) return;
+
+        eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if(m_surface != EGL_NO_SURFACE) eglDestroySurface(m_display, m_surface);
+        if(m_context != EGL_NO_CONTEXT) eglDestroyContext(m_display, m_context);
+        eglTerminate(m_display);
+
+        m_surface = EGL_NO_SURFACE;
+        m_context = EGL_NO_CONTEXT;
+        m_display = EGL_NO_DISPLAY;
+    }
+
+    EGLDisplay m_display;
+    EGLContext m_context;
+    EGLSurface m_surface;
+
+    GLuint m_framebuffer;
+    GLuint m_renderbuffers[2];
+    int m_width, m_height;
+
+    std::atomic<bool> m_closeRequested;
+    std::chrono::steady_clock::time_point m_startTime;
+};
+
+#endif // CONTEXT_H_INCLUDED
@@ -0,0 +1,132 @@
+#ifndef FRAMEPACER_H_INCLUDED
+#define FRAMEPACER_H_INCLUDED
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum PresentMode {
+    PRESENT_VSYNC,     // swap interval 1
+    PRESENT_IMMEDIATE, // swap interval 0, may tear
+    PRESENT_ADAPTIVE   // swap interval -1: vsync, but late frames are shown right away
+};
+
+const char* const PRESENT_MODE_NAMES[] = {
+    "vsync", "immediate", "adaptive"
+};
+
+// Caps the frame rate and measures how evenly frames are delivered. The
+// wait sleeps until shortly before the deadline, since sleeps overshoot by
+// up to a scheduler tick, and spins for the rest.
+class FramePacer {
+public:
+    static const std::size_t MAX_SAMPLES = 36000;
+
+    FramePacer(): m_period(0), m_started(false) { }
+
+    // 0 disables the limiter
+    void setFrameRateLimit(double framesPerSecond) {
+        m_period = framesPerSecond > 0.0 ? std::chrono::duration_cast<Clock::duration>(
+                                               std::chrono::duration<double>(1.0 / framesPerSecond))
+                                         : Clock::duration(0);
+    }
+
+    // Call right after the swap
+    void endFrame() {
+        Clock::time_point now = Clock::now();
+
+        if(m_period.count() > 0) {
+            if(!m_started) m_deadline = now;
+            m_deadline += m_period;
+
+            // Too late to catch up without a burst of short frames, start over from now
+            if(m_deadline < now) m_deadline = now;
+
+            if(m_deadline - now > SPIN_TIME) std::this_thread::sleep_for(m_deadline - now - SPIN_TIME);
+            while(Clock::now() < m_deadline) { }
+
+            now = Clock::now();
+        }
+
+        if(m_started && m_intervals.size() < MAX_SAMPLES) {
+            m_intervals.push_back(std::chrono::duration<double, std::milli>(now - m_lastFrame).count());
+        }
+        m_lastFrame = now;
+        m_started = true;
+    }
+
+    // Interval mean, standard deviation and the 99th percentile of the deviation from the mean, in milliseconds
+    void printReport(const std::string& configuration) const {
+        if(m_intervals.empty()) return;
+
+        double mean = 0.0;
+        for(double interval : m_intervals) mean += interval;
+        mean /= m_intervals.size();
+
+        double variance = 0.0;
+        std::vector<double> deviations;
+        deviations.reserve(m_intervals.size());
+        for(double interval : m_intervals) {
+            variance += (interval - mean) * (interval - mean);
+            deviations.push_back(std::fabs(interval - mean));
+        }
+        variance /= m_intervals.size();
+
+        std::sort(deviations.begin(), deviations.end());
+        double p99 = deviations[std::min(deviations.size() - 1, (std::size_t)(deviations.size() * 0.99))];
+
+        std::cout << "Frame pacing (" << configuration << "): " << mean << " ms interval, "
+                  << std::sqrt(variance) << " ms jitter, " << p99 << " ms p99 deviation, "
+                  << deviations.back() << " ms worst\n";
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr std::chrono::microseconds SPIN_TIME{1500};
+
+    Clock::duration m_period;
+    Clock::time_point m_deadline;
+    Clock::time_point m_lastFrame;
+    bool m_started;
+
+    std::vector<double> m_intervals;
+};
+
+// Deltas handed to the simulation: a hitch (window drag, breakpoint) is
+// clamped to MAX_DELTA so the snake doesn't race through the missed ticks,
+// and the rest is averaged over the last few frames to hide timer noise.
+class DeltaFilter {
+public:
+    static constexpr double MAX_DELTA = 1.0;
+    static const int HISTORY = 8;
+
+    DeltaFilter(): m_count(0), m_next(0), m_smoothing(true) { }
+
+    void setSmoothing(bool smoothing) { m_smoothing = smoothing; }
+
+    double filter(double delta) {
+        delta = std::min(std::max(delta, 0.0), MAX_DELTA);
+        if(!m_smoothing) return delta;
+
+        m_history[m_next] = delta;
+        m_next = (m_next + 1) % HISTORY;
+        if(m_count < HISTORY) m_count++;
+
+        double sum = 0.0;
+        for(int i = 0; i < m_count; i++) sum += m_history[i];
+        return sum / m_count;
+    }
+
+private:
+    double m_history[HISTORY];
+    int m_count;
+    int m_next;
+    bool m_smoothing;
+};
+
+#endif // FRAMEPACER_H_INCLUDED
@@ -0,0 +1,371 @@
+#include "framerecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    bool endsWith(const std::string& text, const char* suffix) {
+        std::size_t length = std::strlen(suffix);
+        return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::uint32_t crc32(const unsigned char* data, std::size_t size, std::uint32_t crc = 0) {
+        static std::uint32_t table[256];
+        static bool tableReady = false;
+        if(!tableReady) {
+            for(std::uint32_t i = 0; i < 256; i++) {
+                std::uint32_t value = i;
+                for(int bit = 0; bit < 8; bit++) value = value & 1 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+                table[i] = value;
+            }
+            tableReady = true;
+        }
+
+        crc = ~crc;
+        for(std::size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    std::uint32_t adler32(const unsigned char* data, std::size_t size) {
+        std::uint32_t a = 1, b = 0;
+        while(size > 0) {
+            // Largest run that can't overflow b before the modulo
+            std::size_t run = std::min<std::size_t>(size, 5552);
+            for(std::size_t i = 0; i < run; i++) {
+                a += data[i];
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+            data += run;
+            size -= run;
+        }
+        return (b << 16) | a;
+    }
+
+    void putBigEndian(std::vector<unsigned char>& out, std::uint32_t value) {
+        out.push_back(value >> 24);
+        out.push_back(value >> 16);
+        out.push_back(value >> 8);
+        out.push_back(value);
+    }
+
+    void writeChunk(std::FILE* file, const char* type, const unsigned char* data, std::size_t size) {
+        std::vector<unsigned char> header;
+        putBigEndian(header, size);
+        header.insert(header.end(), type, type + 4);
+
+        std::vector<unsigned char> footer;
+        putBigEndian(footer, crc32(data, size, crc32(header.data() + 4, 4)));
+
+        std::fwrite(header.data(), 1, header.size(), file);
+        std::fwrite(data, 1, size, file);
+        std::fwrite(footer.data(), 1, footer.size(), file);
+    }
+
+    // BT.601 studio range, as players assume for Y4M without a colour tag
+    unsigned char lumaOf(int r, int g, int b) { return (66 * r + 129 * g + 25 * b + 128 + 16 * 256) >> 8; }
+    unsigned char blueDifferenceOf(int r, int g, int b) { return (-38 * r - 74 * g + 112 * b + 128 + 128 * 256) >> 8; }
+    unsigned char redDifferenceOf(int r, int g, int b) { return (112 * r - 94 * g - 18 * b + 128 + 128 * 256) >> 8; }
+}
+
+FrameRecorder::FrameRecorder(const std::string& path, int width, int height, int frameRate):
+    m_path(path), m_format(FORMAT_PNG), m_width(width), m_height(height), m_frameRate(std::max(frameRate, 1)),
+    m_valid(false), m_finished(false), m_nextReadback(0), m_frameIndex(0), m_video(NULL), m_videoFrames(0), m_stopping(false) {
+
+    if(endsWith(path, ".y4m")) {
+        m_format = FORMAT_Y4M;
+        m_video = std::fopen(path.c_str(), "wb");
+        if(m_video == NULL) {
+            std::cout << "Unable to open " << path << " for recording!\n";
+            return;
+        }
+        std::fprintf(m_video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", m_width, m_height, m_frameRate);
+    } else if(endsWith(path, ".png")) {
+        m_format = FORMAT_PNG;
+        m_path = path.substr(0, path.size() - 4);
+    } else {
+        std::cout << "Unable to record to " << path << ", expected a .png or .y4m path!\n";
+        return;
+    }
+
+    std::size_t frameSize = (std::size_t)m_width * m_height * 4;
+    for(int i = 0; i < READBACK_SLOTS; i++) {
+        glGenBuffers(1, &m_readbacks[i].buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbacks[i].buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameSize, NULL, GL_STREAM_READ);
+        m_readbacks[i].fence = 0;
+        m_readbacks[i].frame = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    for(int i = 0; i < QUEUE_LENGTH; i++) {
+        m_frames[i].pixels.resize(frameSize);
+        m_freeFrames.push_back(&m_frames[i]);
+    }
+
+    m_worker = std::thread(&FrameRecorder::encodeLoop, this);
+    m_valid = true;
+}
+
+FrameRecorder::~FrameRecorder() {
+    if(!m_valid) {
+        if(m_video != NULL) std::fclose(m_video);
+        return;
+    }
+
+    finish();
+    for(int i = 0; i < READBACK_SLOTS; i++) glDeleteBuffers(1, &m_readbacks[i].buffer);
+}
+
+void FrameRecorder::capture() {
+    if(!m_valid || m_finished) return;
+
+    auto start = std::chrono::steady_clock::now();
+    m_stats.frames++;
+
+    collect(false);
+
+    Readback& readback = m_readbacks[m_nextReadback];
+    if(readback.fence != 0) {
+        m_stats.readbackDrops++;
+    } else {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        readback.frame = m_frameIndex;
+        m_nextReadback = (m_nextReadback + 1) % READBACK_SLOTS;
+    }
+    m_frameIndex++;
+
+    double elapsed = secondsSince(start);
+    m_stats.captureTime += elapsed;
+    m_stats.maxCaptureTime = std::max(m_stats.maxCaptureTime, elapsed);
+}
+
+void FrameRecorder::finish() {
+    if(!m_valid || m_finished) return;
+    m_finished = true;
+
+    collect(true);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_queued.notify_one();
+    m_worker.join();
+
+    // Frames dropped after the last one written still take their time
+    if(m_video != NULL && m_videoFrames > 0 && m_videoFrames < m_frameIndex) {
+        m_stats.repeated += m_frameIndex - m_videoFrames;
+        writeVideoFrames(m_frameIndex - m_videoFrames);
+    }
+
+    if(m_video != NULL) {
+        std::fclose(m_video);
+        m_video = NULL;
+    }
+}
+
+void FrameRecorder::printReport() const {
+    if(!m_valid) return;
+
+    std::cout << "Recorded " << m_stats.encoded << " of " << m_stats.frames << " frames to "
+              << m_path << (m_format == FORMAT_PNG ? "_*.png" : "") << ", dropped "
+              << m_stats.readbackDrops << " waiting for readback and " << m_stats.encoderDrops << " with the encoder behind\n";
+    if(m_stats.repeated > 0) std::cout << "  " << m_stats.repeated << " frames repeated in the video in place of dropped ones\n";
+    std::cout << "  capture: " << m_stats.captureTime * 1000.0 / std::max(m_stats.frames, 1UL) << " ms/frame on the GL thread, "
+              << m_stats.maxCaptureTime * 1000.0 << " ms at most; encode: "
+              << m_stats.encodeTime * 1000.0 / std::max(m_stats.encoded, 1UL) << " ms/frame\n";
+}
+
+// Hands every readback that has landed to the encoder, oldest first. Without
+// wait, readbacks still in flight are left for a later frame.
+void FrameRecorder::collect(bool wait) {
+    std::size_t frameSize = (std::size_t)m_width * m_height * 4;
+
+    for(int i = 0; i < READBACK_SLOTS; i++) {
+        Readback& readback = m_readbacks[(m_nextReadback + i) % READBACK_SLOTS];
+        if(readback.fence == 0) continue;
+
+        GLenum status = glClientWaitSync(readback.fence, 0, 0);
+        while(wait && status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        if(status == GL_TIMEOUT_EXPIRED) break; // fences signal in order, the later ones are still pending too
+
+        glDeleteSync(readback.fence);
+        readback.fence = 0;
+
+        Frame* frame = acquireFrame(wait);
+        if(frame == NULL) {
+            m_stats.encoderDrops++;
+            continue;
+        }
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameSize, GL_MAP_READ_BIT);
+        if(pixels != NULL) {
+            std::memcpy(frame->pixels.data(), pixels, frameSize);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        frame->index = readback.frame;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(pixels != NULL) m_queuedFrames.push_back(frame);
+            else m_freeFrames.push_back(frame);
+        }
+        m_queued.notify_one();
+    }
+}
+
+FrameRecorder::Frame* FrameRecorder::acquireFrame(bool wait) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if(wait) m_freed.wait(lock, [this] { return !m_freeFrames.empty(); });
+    if(m_freeFrames.empty()) return NULL;
+
+    Frame* frame = m_freeFrames.back();
+    m_freeFrames.pop_back();
+    return frame;
+}
+
+void FrameRecorder::encodeLoop() {
+    bool failed = false;
+
+    while(true) {
+        Frame* frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queued.wait(lock, [this] { return m_stopping || !m_queuedFrames.empty(); });
+            if(m_queuedFrames.empty()) return;
+
+            frame = m_queuedFrames.front();
+            m_queuedFrames.pop_front();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool written = m_format == FORMAT_PNG ? writePNG(*frame) : writeY4M(*frame);
+        if(written) {
+            m_stats.encoded++;
+            m_stats.encodeTime += secondsSince(start);
+        } else if(!failed) {
+            std::cout << "Unable to write frame " << frame->index << " of the recording!\n";
+            failed = true;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_freeFrames.push_back(frame);
+        }
+        m_freed.notify_one();
+    }
+}
+
+// Truecolor PNG with the image data in stored (uncompressed) deflate blocks;
+// no compression keeps the encoder well ahead of the frame rate. Recompress
+// the files afterwards when size matters.
+bool FrameRecorder::writePNG(const Frame& frame) {
+    char number[16];
+    std::snprintf(number, sizeof(number), "_%06lu.png", frame.index);
+    std::FILE* file = std::fopen((m_path + number).c_str(), "wb");
+    if(file == NULL) return false;
+
+    // Scanlines top row first, each behind a filter type byte of 0
+    std::size_t rowSize = 1 + (std::size_t)m_width * 3;
+    std::size_t rawSize = rowSize * m_height;
+    std::vector<unsigned char>& raw = m_scratch;
+    raw.resize(rawSize);
+    for(int y = 0; y < m_height; y++) {
+        const unsigned char* source = &frame.pixels[(std::size_t)(m_height - 1 - y) * m_width * 4];
+        unsigned char* row = &raw[y * rowSize];
+        row[0] = 0;
+        for(int x = 0; x < m_width; x++) {
+            row[1 + x * 3 + 0] = source[x * 4 + 0];
+            row[1 + x * 3 + 1] = source[x * 4 + 1];
+            row[1 + x * 3 + 2] = source[x * 4 + 2];
+        }
+    }
+
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::fwrite(signature, 1, sizeof(signature), file);
+
+    std::vector<unsigned char> header;
+    putBigEndian(header, m_width);
+    putBigEndian(header, m_height);
+    header.push_back(8); // bit depth
+    header.push_back(2); // truecolor
+    header.push_back(0); // deflate
+    header.push_back(0); // adaptive filtering
+    header.push_back(0); // no interlace
+    writeChunk(file, "IHDR", header.data(), header.size());
+
+    const std::size_t MAX_BLOCK = 65535;
+    std::vector<unsigned char> data;
+    data.reserve(rawSize + (rawSize / MAX_BLOCK + 1) * 5 + 6);
+    data.push_back(0x78); // zlib header: deflate, 32K window, no dictionary
+    data.push_back(0x01);
+    for(std::size_t offset = 0; offset < rawSize; offset += MAX_BLOCK) {
+        std::size_t size = std::min(MAX_BLOCK, rawSize - offset);
+        data.push_back(offset + size == rawSize ? 1 : 0); // final block flag, stored type
+        data.push_back(size & 0xFF);
+        data.push_back(size >> 8);
+        data.push_back(~size & 0xFF);
+        data.push_back((~size >> 8) & 0xFF);
+        data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + size);
+    }
+    putBigEndian(data, adler32(raw.data(), rawSize));
+    writeChunk(file, "IDAT", data.data(), data.size());
+    writeChunk(file, "IEND", NULL, 0);
+
+    bool written = !std::ferror(file);
+    return std::fclose(file) == 0 && written;
+}
+
+// 4:4:4 planes so the thin board lines keep their colour. Frames dropped since
+// the last one written are filled in with it, those before the first frame
+// with the first frame.
+bool FrameRecorder::writeY4M(const Frame& frame) {
+    unsigned long dropped = frame.index - m_videoFrames;
+    m_stats.repeated += dropped;
+    if(m_videoFrames > 0) writeVideoFrames(dropped);
+
+    std::size_t planeSize = (std::size_t)m_width * m_height;
+    std::vector<unsigned char>& planes = m_scratch;
+    planes.resize(planeSize * 3);
+
+    for(int y = 0; y < m_height; y++) {
+        const unsigned char* source = &frame.pixels[(std::size_t)(m_height - 1 - y) * m_width * 4];
+        std::size_t row = (std::size_t)y * m_width;
+        for(int x = 0; x < m_width; x++) {
+            int r = source[x * 4 + 0], g = source[x * 4 + 1], b = source[x * 4 + 2];
+            planes[row + x] = lumaOf(r, g, b);
+            planes[planeSize + row + x] = blueDifferenceOf(r, g, b);
+            planes[planeSize * 2 + row + x] = redDifferenceOf(r, g, b);
+        }
+    }
+
+    writeVideoFrames(m_videoFrames == 0 ? dropped + 1 : 1);
+    return !std::ferror(m_video);
+}
+
+// Writes the planes in m_scratch as count frames
+void FrameRecorder::writeVideoFrames(unsigned long count) {
+    for(unsigned long i = 0; i < count; i++) {
+        std::fputs("FRAME\n", m_video);
+        std::fwrite(m_scratch.data(), 1, m_scratch.size(), m_video);
+    }
+    m_videoFrames += count;
+}
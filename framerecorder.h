@@ -0,0 +1,106 @@
+#ifndef FRAMERECORDER_H_INCLUDED
+#define FRAMERECORDER_H_INCLUDED
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct FrameRecorderStats {
+    unsigned long frames = 0;          // capture() calls
+    unsigned long encoded = 0;
+    unsigned long readbackDrops = 0;   // every pixel buffer was still being filled
+    unsigned long encoderDrops = 0;    // the encoder queue was full
+    double captureTime = 0.0;          // spent in capture() on the GL thread, seconds
+    double maxCaptureTime = 0.0;
+    double encodeTime = 0.0;           // spent encoding and writing on the worker, seconds
+    unsigned long repeated = 0;        // Y4M frames written again in place of dropped ones
+};
+
+// Records the frames drawn into the framebuffer bound for reading. glReadPixels
+// goes into a ring of pixel buffer objects and a frame is only copied out once
+// its fence has passed, a few frames later, so the GL thread never waits for
+// the readback. A worker thread encodes the copies to numbered PNG files or
+// one Y4M video.
+//
+// When the ring or the encoder queue is full the frame is dropped and counted
+// instead; PNG numbers skip dropped frames, a Y4M video shows the frame before
+// again in their place so it keeps time. The size is fixed when recording
+// starts.
+class FrameRecorder {
+public:
+    static const int READBACK_SLOTS = 3;
+    static const int QUEUE_LENGTH = 4;
+
+    enum Format {
+        FORMAT_PNG, FORMAT_Y4M
+    };
+
+    // A path ending in .y4m records a video at frameRate, one ending in .png
+    // an image sequence with the frame number appended to the name
+    FrameRecorder(const std::string& path, int width, int height, int frameRate);
+    ~FrameRecorder();
+
+    bool isValid() const { return m_valid; }
+
+    // Call on the GL thread after the frame is drawn and before it is swapped
+    void capture();
+
+    // Waits for the outstanding readbacks and the encoder; the GL context must be current
+    void finish();
+
+    const FrameRecorderStats& getStats() const { return m_stats; }
+    void printReport() const;
+
+private:
+    struct Readback {
+        GLuint buffer;
+        GLsync fence;
+        unsigned long frame;
+    };
+
+    struct Frame {
+        std::vector<unsigned char> pixels; // RGBA, bottom row first
+        unsigned long index;
+    };
+
+    void collect(bool wait);
+    Frame* acquireFrame(bool wait);
+
+    void encodeLoop();
+    bool writePNG(const Frame& frame);
+    bool writeY4M(const Frame& frame);
+    void writeVideoFrames(unsigned long count);
+
+    std::string m_path;
+    Format m_format;
+    int m_width, m_height, m_frameRate;
+    bool m_valid;
+    bool m_finished;
+
+    Readback m_readbacks[READBACK_SLOTS];
+    int m_nextReadback;
+    unsigned long m_frameIndex;
+
+    std::FILE* m_video;
+    unsigned long m_videoFrames; // written so far, the index the next frame should have
+    std::vector<unsigned char> m_scratch; // encoder's own buffer
+
+    Frame m_frames[QUEUE_LENGTH];
+    std::vector<Frame*> m_freeFrames;
+    std::deque<Frame*> m_queuedFrames;
+    std::mutex m_mutex;
+    std::condition_variable m_queued;
+    std::condition_variable m_freed;
+    bool m_stopping;
+    std::thread m_worker;
+
+    FrameRecorderStats m_stats;
+};
+
+#endif // FRAMERECORDER_H_INCLUDED
@@ -0,0 +1,36 @@
+#ifndef FRUSTUM_H_INCLUDED
+#define FRUSTUM_H_INCLUDED
+
+#include <glm/glm.hpp>
+
+// View frustum as six planes (xyz normal pointing inwards, w distance),
+// extracted from a view-projection matrix (Gribb & Hartmann)
+struct Frustum {
+    glm::vec4 planes[6];
+
+    void update(const glm::mat4& viewProjection) {
+        glm::vec4 row[4];
+        for(int i = 0; i < 4; i++) {
+            row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        }
+
+        planes[0] = row[3] + row[0]; // left
+        planes[1] = row[3] - row[0]; // right
+        planes[2] = row[3] + row[1]; // bottom
+        planes[3] = row[3] - row[1]; // top
+        planes[4] = row[3] + row[2]; // near
+        planes[5] = row[3] - row[2]; // far
+    }
+
+    // Conservative: boxes near a corner of the frustum may pass without being visible
+    bool intersectsBox(const glm::vec3& center, const glm::vec3& halfSize) const {
+        for(int i = 0; i < 6; i++) {
+            glm::vec3 normal(planes[i]);
+            float radius = glm::dot(halfSize, glm::abs(normal));
+            if(glm::dot(normal, center) + planes[i].w < -radius) return false;
+        }
+        return true;
+    }
+};
+
+#endif // FRUSTUM_H_INCLUDED
@@ -2,7 +2,13 @@
 #define GAME_H
 
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <string>
+#include <fstream>
+#include <thread>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
@@ -10,106 +16,394 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "context.h"
+#include "glrenderer.h"
+#include "softwarerenderer.h"
+#include "framepacer.h"
+#include "framerecorder.h"
+#include "glextensions.h"
 #include "systems.h"
+#include "triplebuffer.h"
 
+struct GameOptions {
+    // Render into an offscreen framebuffer of a surfaceless EGL context instead of a window
+    bool headless = false;
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-    glViewport(0, 0, width, height);
-}
+    // Stop after this many frames, 0 runs until the window is closed
+    unsigned long frameLimit = 0;
+
+    // Headless runs step the simulation by this fixed delta so captures are reproducible
+    double headlessDelta = 1.0 / 60.0;
+
+    // Written as PPM after the last frame
+    std::string capturePath;
+
+    // Record every frame to numbered PNGs (name.png) or a Y4M video (name.y4m) without stalling the frame
+    std::string recordPath;
+
+    // Per-frame GPU pass and CPU times, JSON when the name ends in .json and CSV otherwise
+    std::string gpuTimingsPath;
+
+    // Linked shader programs are cached here between launches, empty disables the cache
+    std::string shaderCacheDirectory;
+
+    // Load shaders from this directory instead of the copies embedded at build time
+    std::string shaderDirectory;
+
+    // Draw on a second thread owning the GL context while this one simulates at SIMULATION_RATE.
+    // Single-threaded runs step once per frame, which headless captures rely on.
+    bool renderThread = true;
+
+    // Ignored headless, there is no display to sync to
+    PresentMode presentMode = PRESENT_VSYNC;
+
+    // Frames per second, 0 leaves the rate to the present mode
+    double frameRateLimit = 0.0;
+
+    // Average the simulation delta over the last frames; it is clamped to DeltaFilter::MAX_DELTA either way
+    bool smoothDelta = true;
+
+    // Trace turn key presses to the frame showing them and print the latency distribution.
+    // Without a window a turn is injected every latencyTurnInterval seconds instead.
+    bool measureLatency = false;
+    double latencyTurnInterval = 0.5;
+
+    // Rasterize on the CPU and only blit the finished frame through GL
+    bool softwareRenderer = false;
+
+    // Draw straight runs of the snake as one box each instead of one cube per segment
+    bool mergeSnakeRuns = true;
+
+    // GL renderer paths kept for benchmarking: a draw call per cube, and the snake drawn as cube instances
+    // instead of pulled from its segment buffer
+    bool instancing = true;
+    bool vertexPulling = true;
+};
+
+// Time spent per iteration of a loop, in milliseconds
+struct LoopTimings {
+    unsigned long count = 0;
+    double totalFrame = 0.0; // start to start, including any waiting
+    double totalBusy = 0.0;  // the loop's own work
+    double maxBusy = 0.0;
+
+    void add(double frame, double busy) {
+        count++;
+        totalFrame += frame;
+        totalBusy += busy;
+        maxBusy = std::max(maxBusy, busy);
+    }
+
+    void print(const char* name) const {
+        if(count == 0) return;
+        std::cout << name << ": " << count << " iterations, " << totalFrame / count << " ms/iteration, "
+                  << totalBusy / count << " ms busy on average, " << maxBusy << " ms at most\n";
+    }
+};
 
 class Game {
 public:
-    Game(const char* title, int width, int height): m_lastTime(0.0), m_deltaTime(0.0) {
-        glfwInit();
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    Game(const char* title, int width, int height, const GameOptions& options = GameOptions()):
+        m_options(options), m_lastTime(0.0), m_deltaTime(0.0), m_tickAccumulator(0.0), m_frameCount(0), m_stopRendering(false), m_lastInjectedTurn(0.0),
+        m_recorder(NULL), m_inputSystem(NULL), m_renderingSystem(NULL), m_appleSpawningSystem(NULL), m_movingSystem(NULL), m_glLoaded(false) {
 
-        m_pwindow = glfwCreateWindow(width, height, title, NULL, NULL);
-        if(m_pwindow == NULL) {
-            std::cout << "Unable to create window!\n";
-            glfwTerminate();
-        }
-        glfwMakeContextCurrent(m_pwindow);
+        if(m_options.headless) m_context = new HeadlessContext(width, height);
+        else m_context = new WindowContext(title, width, height);
 
-        if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        // Nothing else is set up without GL, isValid tells the caller
+        if(!m_context->isValid()) return;
+        if(!gladLoadGLLoader(m_context->getProcLoader())) {
             std::cout << "Unable to initialize GLAD!\n";
+            return;
         }
+        m_glLoaded = true;
+        GLExtensions::load(m_context->getProcLoader());
+        m_context->initGL();
+        m_context->setPresentMode(m_options.presentMode);
 
+        m_framePacer.setFrameRateLimit(m_options.frameRateLimit);
+        m_deltaFilter.setSmoothing(m_options.smoothDelta);
+
+        Program::setBinaryCacheDirectory(m_options.shaderCacheDirectory);
+        Program::setSourceDirectory(m_options.shaderDirectory);
 
-        glfwSetFramebufferSizeCallback(m_pwindow, framebuffer_size_callback);
         glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
 
         m_inputSystem = new InputProcessingSystem();
-        m_renderingSystem = new RenderingSystem();
+        if(m_options.softwareRenderer) {
+            SoftwareRenderer* renderer = new SoftwareRenderer(m_context->getWidth(), m_context->getHeight());
+            std::cout << "Software renderer: " << renderer->getInstructionSet() << ", "
+                      << renderer->getThreadCount() << " threads\n";
+            m_renderingSystem = new RenderingSystem(renderer);
+        } else {
+            GLRenderer* renderer = new GLRenderer();
+            renderer->setInstanced(m_options.instancing);
+            renderer->setVertexPulling(m_options.vertexPulling);
+            m_renderingSystem = new RenderingSystem(renderer);
+        }
+        m_renderingSystem->getSnakeMesher().setMerging(m_options.mergeSnakeRuns);
         m_movingSystem = new MovingSystem();
         m_appleSpawningSystem = new AppleSpawningSystem();
 
+        m_registry.set<OccupancyGrid>();
         initSnake();
+
+        if(!m_options.recordPath.empty()) {
+            m_recorder = new FrameRecorder(m_options.recordPath, m_context->getWidth(), m_context->getHeight(), getRecordingRate());
+        }
+
+        if(m_options.measureLatency) {
+            m_inputSystem->setLatencyTracer(&m_latencyTracer);
+            if(m_context->getWindow() != NULL) m_latencyTracer.attach(m_context->getWindow());
+        }
     }
 
     ~Game() {
+        delete m_recorder;
         delete m_inputSystem;
         delete m_renderingSystem;
         delete m_movingSystem;
         delete m_appleSpawningSystem;
-        glfwTerminate();
+        delete m_context;
     }
 
     void initSnake() {
-        entt::entity snake = m_registry.create();
-        m_registry.assign<Snake>(snake, glm::vec3(0.0f, 0.0f, 0.0f), Direction::TOP, 5.0f);
-
-        Snake& snakeComponent = m_registry.get<Snake>(snake);
-        snakeComponent.parts.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
-        snakeComponent.parts.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
-        snakeComponent.parts.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
-        snakeComponent.parts.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
+        createSnake(m_registry, glm::ivec3(0, 0, 0), Direction::TOP, 6);
     }
 
     void run() {
-        while(!glfwWindowShouldClose(m_pwindow)) {
-            double currentTime = glfwGetTime();
-            m_deltaTime = (currentTime - m_lastTime) / 1.0f;
+        double startTime = m_context->getTime();
+        m_lastTime = startTime;
+
+        if(m_options.renderThread) {
+            runThreaded();
+        } else {
+            while(!m_context->shouldClose()) {
+                double currentTime = m_context->getTime();
+                m_deltaTime = m_options.headless ? m_options.headlessDelta : m_deltaFilter.filter(currentTime - m_lastTime);
+                m_lastTime = currentTime;
+
+                processInput();
+                update();
+                draw();
+            }
+        }
+
+        if(m_options.headless) {
+            double elapsed = m_context->getTime() - startTime;
+            std::cout << "Rendered " << m_frameCount << " frames in " << elapsed << " s ("
+                      << elapsed * 1000.0 / std::max(m_frameCount, 1UL) << " ms/frame)\n";
+        }
+
+        if(m_recorder != NULL) {
+            m_recorder->finish();
+            m_recorder->printReport();
+        }
+
+        m_simulationTimings.print("Simulation thread");
+        m_renderTimings.print("Render thread");
+        m_renderingSystem->getSnakeMesher().printReport();
+        m_framePacer.printReport(describePacing());
+        if(m_options.measureLatency) m_latencyTracer.printReport(describePacing());
+
+        if(!m_options.gpuTimingsPath.empty()) {
+            writeGpuTimings(m_options.gpuTimingsPath);
+        }
+    }
+
+    // The simulation stays on this thread, GLFW wants its events polled here. Snapshots go to the
+    // render thread through a triple buffer, so a blocking swap never holds up a tick or vice versa.
+    void runThreaded() {
+        m_context->releaseCurrent();
+        std::thread renderThread(&Game::renderLoop, this);
+
+        const auto tickPeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / Constants::SIMULATION_RATE));
+        auto nextTick = std::chrono::steady_clock::now();
+        auto lastStart = nextTick;
+
+        while(!m_context->shouldClose()) {
+            auto start = std::chrono::steady_clock::now();
+
+            double currentTime = m_context->getTime();
+            m_deltaTime = m_deltaFilter.filter(currentTime - m_lastTime);
             m_lastTime = currentTime;
 
             processInput();
             update();
-            draw();
+
+            capture(m_snapshots.getBack());
+            m_snapshots.publish();
+
+            auto end = std::chrono::steady_clock::now();
+            m_simulationTimings.add(milliseconds(start - lastStart), milliseconds(end - start));
+            lastStart = start;
+
+            nextTick = std::max(nextTick + tickPeriod, end);
+            std::this_thread::sleep_until(nextTick);
+        }
+
+        m_stopRendering = true;
+        renderThread.join();
+        m_context->makeCurrent();
+    }
+
+    void renderLoop() {
+        if(!m_context->makeCurrent()) {
+            std::cout << "Unable to make the GL context current on the render thread!\n";
+            m_context->requestClose();
+            return;
+        }
+        m_context->setPresentMode(m_options.presentMode);
+
+        auto lastStart = std::chrono::steady_clock::now();
+        while(!m_stopRendering) {
+            auto start = std::chrono::steady_clock::now();
+
+            // Keeps drawing the previous snapshot when the simulation hasn't published a new one
+            m_snapshots.acquire();
+            drawFrame(m_snapshots.getFront(), m_context->getTime());
+
+            m_renderTimings.add(milliseconds(start - lastStart), milliseconds(std::chrono::steady_clock::now() - start));
+            lastStart = start;
+
+            if(m_options.frameLimit != 0 && m_frameCount >= m_options.frameLimit) break;
         }
 
+        m_context->releaseCurrent();
+    }
+
+    void writeGpuTimings(const std::string& path) {
+        std::ofstream file(path);
+        if(!file) {
+            std::cout << "Unable to open " << path << " for the GPU timings!\n";
+            return;
+        }
+
+        const GpuTimer* timer = m_renderingSystem->getRenderer().getGpuTimer();
+        if(timer == NULL) {
+            std::cout << "Unable to write GPU timings, the renderer doesn't draw on the GPU!\n";
+            return;
+        }
+
+        bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+        if(json) timer->writeJSON(file);
+        else timer->writeCSV(file);
     }
 
     void processInput() {
-        if(glfwGetKey(m_pwindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-            glfwSetWindowShouldClose(m_pwindow, true);
+        GLFWwindow* window = m_context->getWindow();
+        if(window != NULL) {
+            if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+                m_context->requestClose();
 
-        m_inputSystem->processInput(m_registry, m_dispatcher, m_pwindow);
+            m_inputSystem->processInput(m_registry, m_dispatcher, window);
+        } else if(m_options.measureLatency && m_lastTime - m_lastInjectedTurn >= m_options.latencyTurnInterval) {
+            m_inputSystem->injectTurn(m_registry);
+            m_lastInjectedTurn = m_lastTime;
+        }
 
-        glfwPollEvents();
+        m_context->pollEvents();
     }
 
+    // Runs every whole tick that fits in the time since the last update, so a slow frame catches up
+    // and the game plays the same at any frame rate. What is left over is how far into the next tick
+    // the snake is drawn.
     void update() {
-        m_inputSystem->update(m_registry, m_dispatcher, m_deltaTime);
-        m_movingSystem->update(m_registry, m_dispatcher, m_deltaTime);
-        m_appleSpawningSystem->update(m_registry, m_dispatcher, m_deltaTime);
+        m_tickAccumulator += m_deltaTime;
+
+        // Fixed deltas only add up to a tick up to rounding
+        while(m_tickAccumulator >= TICK_TIME - 1e-9) {
+            m_inputSystem->update(m_registry, m_dispatcher, TICK_TIME);
+            m_movingSystem->update(m_registry, m_dispatcher, TICK_TIME);
+            m_appleSpawningSystem->update(m_registry, m_dispatcher, TICK_TIME);
+            m_tickAccumulator = std::max(m_tickAccumulator - TICK_TIME, 0.0);
+        }
+    }
+
+    void capture(RenderSnapshot& snapshot) {
+        m_renderingSystem->capture(m_registry, snapshot);
+        snapshot.tickProgress = m_tickAccumulator;
+        snapshot.captureTime = m_lastTime;
+        snapshot.lastTurn = m_latencyTracer.getLastTurn();
     }
 
     void draw() {
-        glClearColor(0.73f, 0.88f, 0.98f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        capture(m_snapshot);
+        drawFrame(m_snapshot, m_snapshot.captureTime);
+
+        m_context->pollEvents();
+    }
+
+    // time is now on the context's clock
+    void drawFrame(const RenderSnapshot& snapshot, double time) {
+        m_context->updateViewport();
+        m_renderingSystem->draw(snapshot, time);
 
-        m_renderingSystem->draw(m_registry, m_dispatcher);
+        if(!m_options.capturePath.empty() && m_options.frameLimit != 0 && m_frameCount + 1 == m_options.frameLimit) {
+            m_context->captureFrame(m_options.capturePath);
+        }
+        if(m_recorder != NULL) m_recorder->capture();
 
-        glfwSwapBuffers(m_pwindow);
-        glfwPollEvents();
+        m_context->swapBuffers();
+        if(m_options.measureLatency) m_latencyTracer.frameShown(snapshot.lastTurn);
+        m_framePacer.endFrame();
+
+        m_frameCount++;
+        if(m_options.frameLimit != 0 && m_frameCount >= m_options.frameLimit) {
+            m_context->requestClose();
+        }
+    }
+
+    std::string describePacing() const {
+        std::string description = m_options.headless ? "headless" : PRESENT_MODE_NAMES[m_options.presentMode];
+        if(m_options.frameRateLimit > 0.0) description += ", " + std::to_string((int)m_options.frameRateLimit) + " fps limit";
+        return description;
+    }
+
+    // Frames per second the recording plays back at; 0 when frames come as fast as they are drawn
+    int getRecordingRate() const {
+        if(m_options.frameRateLimit > 0.0) return (int)std::lround(m_options.frameRateLimit);
+        if(m_options.headless) return m_options.renderThread ? 0 : (int)std::lround(1.0 / m_options.headlessDelta);
+        if(m_options.presentMode == PRESENT_IMMEDIATE) return 0;
+
+        // Vsync paces the frames at the refresh rate
+        GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+        const GLFWvidmode* mode = monitor != NULL ? glfwGetVideoMode(monitor) : NULL;
+        return mode != NULL && mode->refreshRate > 0 ? mode->refreshRate : 60;
+    }
+
+    bool isValid() const {
+        return m_context->isValid() && m_glLoaded;
     }
 
 private:
-    GLFWwindow* m_pwindow;
+    static double milliseconds(std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    GameOptions m_options;
+    IContext* m_context;
 
     double m_lastTime;
     double m_deltaTime;
+    double m_tickAccumulator;
+    unsigned long m_frameCount;
+
+    // Only the single-threaded loop uses m_snapshot
+    RenderSnapshot m_snapshot;
+    TripleBuffer<RenderSnapshot> m_snapshots;
+    std::atomic<bool> m_stopRendering;
+
+    LoopTimings m_simulationTimings;
+    LoopTimings m_renderTimings;
+
+    FramePacer m_framePacer;
+    LatencyTracer m_latencyTracer;
+    double m_lastInjectedTurn;
+    FrameRecorder* m_recorder;
+    DeltaFilter m_deltaFilter;
 
     entt::registry m_registry;
     entt::dispatcher m_dispatcher;
@@ -118,6 +412,8 @@ private:
     RenderingSystem* m_renderingSystem;
     AppleSpawningSystem* m_appleSpawningSystem;
     MovingSystem* m_movingSystem;
+
+    bool m_glLoaded;
 };
 
 #endif // GAME_H
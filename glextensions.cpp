@@ -0,0 +1,46 @@
+#include "glextensions.h"
+
+#include <cstring>
+
+namespace GLExtensions {
+    bool ARB_buffer_storage = false;
+    bool KHR_parallel_shader_compile = false;
+
+    PFNGLBUFFERSTORAGEPROC glBufferStorage = NULL;
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR = NULL;
+
+    void load(GLADloadproc loader) {
+        if(isVersionAtLeast(4, 4) || isSupported("GL_ARB_buffer_storage")) {
+            glBufferStorage = (PFNGLBUFFERSTORAGEPROC)loader("glBufferStorage");
+            ARB_buffer_storage = (glBufferStorage != NULL);
+        }
+
+        if(isSupported("GL_KHR_parallel_shader_compile")) {
+            glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsKHR");
+        } else if(isSupported("GL_ARB_parallel_shader_compile")) {
+            glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsARB");
+        }
+        KHR_parallel_shader_compile = (glMaxShaderCompilerThreadsKHR != NULL);
+
+        // Let the driver pick how many compiler threads to use
+        if(KHR_parallel_shader_compile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+
+    bool isSupported(const char* extension) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for(GLint i = 0; i < count; i++) {
+            const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if(name != NULL && std::strcmp(name, extension) == 0) return true;
+        }
+
+        return false;
+    }
+
+    bool isVersionAtLeast(int major, int minor) {
+        GLint contextMajor = 0, contextMinor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+        glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+        return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+    }
+}
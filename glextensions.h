@@ -0,0 +1,36 @@
+#ifndef GLEXTENSIONS_H_INCLUDED
+#define GLEXTENSIONS_H_INCLUDED
+
+#include <glad/glad.h>
+
+// Our glad loader is generated for core 4.1 without extensions, so anything
+// newer is declared and loaded here.
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+namespace GLExtensions {
+    extern bool ARB_buffer_storage;
+    // Also set for the ARB variant, which shares the enums
+    extern bool KHR_parallel_shader_compile;
+
+    extern PFNGLBUFFERSTORAGEPROC glBufferStorage;
+    extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR;
+
+    void load(GLADloadproc loader);
+    bool isSupported(const char* extension);
+    bool isVersionAtLeast(int major, int minor);
+}
+
+#endif // GLEXTENSIONS_H_INCLUDED
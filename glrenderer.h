@@ -0,0 +1,584 @@
+#ifndef GLRENDERER_H_INCLUDED
+#define GLRENDERER_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <cstddef>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include "renderer.h"
+#include "camerabuffer.h"
+#include "program.h"
+#include "shaderwatcher.h"
+#include "streambuffer.h"
+#include "gputimer.h"
+#include "cube.h"
+#include "frustum.h"
+#include "renderqueue.h"
+
+const std::size_t INITIAL_INSTANCE_CAPACITY = 1024;
+
+// View distances past this all share the last sort depth
+const float SORT_DEPTH_RANGE = 100.0f;
+
+enum RenderProgram {
+    PROGRAM_CUBE,    // boxes from per-instance attributes
+    PROGRAM_SEGMENT, // cubes pulled from the segment texture buffer
+    PROGRAM_COUNT
+};
+
+const char* const PROGRAM_VERTEX_SHADERS[PROGRAM_COUNT] = { "vertex.glsl", "segment.glsl" };
+const char* const PROGRAM_FRAGMENT_SHADERS[PROGRAM_COUNT] = { "fragment.glsl", "fragment.glsl" };
+
+// The mesh also decides where a command's payload lives
+enum RenderMesh {
+    MESH_CUBE,       // instance streamed this frame, payload indexes the frame's instances
+    MESH_STATIC_BOX, // payload is a StaticBoxID
+    MESH_SEGMENTS    // payload indexes the frame's segment draws
+};
+
+struct CubeInstance {
+    glm::vec4 position; // w is 1 when the box wraps around the board edges
+    glm::vec4 size;
+    glm::vec4 color;
+};
+
+// A renderSnake call: count boxes starting at slot first of the resident ring of capacity slots
+struct SegmentDraw {
+    std::size_t first;
+    std::size_t count;
+    std::size_t capacity;
+    glm::vec4 color;
+};
+
+struct StaticGeometryStats {
+    unsigned long uploads = 0;
+    unsigned long drawnBoxes = 0;
+    unsigned long culledBoxes = 0;
+};
+
+class GLRenderer: public IRenderer {
+public:
+    GLRenderer(): m_shaderWatcher(NULL),
+        m_pass(PASS_SNAKE), m_batchCount(0), m_instanced(true), m_vertexPulling(true),
+        m_segmentBuffer(0), m_segmentCapacity(0),
+        m_staticBuffer(0), m_staticBufferCapacity(0), m_staticDirty(false) {
+
+        m_camera = new CameraBuffer();
+
+        for(int i = 0; i < PROGRAM_COUNT; i++) {
+            m_programs[i] = NULL;
+            m_pendingPrograms[i] = NULL;
+
+            Program* program = Program::load(PROGRAM_VERTEX_SHADERS[i], PROGRAM_FRAGMENT_SHADERS[i]);
+            if(program->hasError()) {
+                std::cout << "Unable to build the " << PROGRAM_VERTEX_SHADERS[i] << " program: " << program->getErrorMessage() << "\n";
+            }
+            setProgram((RenderProgram)i, program);
+        }
+
+        // Shaders loaded from disk are being worked on, pick up their edits while running
+        if(!Program::getSourceDirectory().empty()) {
+            m_shaderWatcher = new ShaderWatcher(Program::getSourceDirectory());
+        }
+
+        m_instanceStream = new StreamBuffer(GL_ARRAY_BUFFER, INITIAL_INSTANCE_CAPACITY * sizeof(CubeInstance));
+        m_instanceCapacity = INITIAL_INSTANCE_CAPACITY;
+
+        // The buffer object only exists once bound, glTexBuffer needs it
+        glGenBuffers(1, &m_segmentBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, m_segmentBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glGenTextures(1, &m_segmentTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, m_segmentTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_segmentBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+        m_gpuTimer = new GpuTimer();
+
+        initBuffers();
+    }
+
+    ~GLRenderer() {
+        for(int i = 0; i < PROGRAM_COUNT; i++) {
+            delete m_programs[i];
+            delete m_pendingPrograms[i];
+        }
+        delete m_shaderWatcher;
+        delete m_instanceStream;
+        delete m_gpuTimer;
+        delete m_camera;
+
+        glDeleteTextures(1, &m_segmentTexture);
+        glDeleteBuffers(1, &m_segmentBuffer);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteVertexArrays(1, &m_emptyVAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        if(m_staticBuffer != 0) glDeleteBuffers(1, &m_staticBuffer);
+    }
+
+    // Boxes crossing the board edge are clipped by the vertex shader; only those get a second, shifted
+    // instance for the part re-entering from the opposite edge
+    void renderWrappedBox(glm::vec3 position, glm::vec3 color, glm::vec3 size) {
+        pushInstance(position, size, color, true);
+
+        glm::vec3 shift = getWrapShift(position - size * 0.5f, position + size * 0.5f);
+        if(shift != glm::vec3(0.0f)) pushInstance(position + shift, size, color, true);
+    }
+
+    void renderBox(glm::vec3 position, glm::vec3 color, glm::vec3 size) {
+        pushInstance(position, size, color, false);
+    }
+
+    // The segment texture buffer mirrors the mesher's ring of boxes, 32 bytes a box. Only the dirty
+    // slots are written, a frame where the snake just moves patches a few of them. The slots whose box
+    // crosses the board edge are tracked from the same writes, their wrapped parts go out as box instances.
+    void renderSnake(const SnakeMeshView& mesh, glm::vec3 color) {
+        if(!m_vertexPulling) {
+            IRenderer::renderSnake(mesh, color);
+            return;
+        }
+
+        glBindBuffer(GL_TEXTURE_BUFFER, m_segmentBuffer);
+        if(mesh.rebuilt || mesh.capacity != m_segmentCapacity) {
+            glBufferData(GL_TEXTURE_BUFFER, mesh.capacity * sizeof(SnakeBox), mesh.slots, GL_DYNAMIC_DRAW);
+            m_segmentCapacity = mesh.capacity;
+
+            m_wrappingSegments.clear();
+            for(std::size_t i = 0; i < mesh.count; i++) updateWrappingSegment(mesh, (mesh.first + i) % mesh.capacity);
+        } else {
+            for(const IndexRange& range : *mesh.dirty) {
+                glBufferSubData(GL_TEXTURE_BUFFER, range.first * sizeof(SnakeBox), (range.last - range.first + 1) * sizeof(SnakeBox),
+                                mesh.slots + range.first);
+                for(std::size_t slot = range.first; slot <= range.last; slot++) updateWrappingSegment(mesh, slot);
+            }
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        if(mesh.count == 0) return;
+        m_queue.push(RenderQueue::makeKey(m_pass, PROGRAM_SEGMENT, MESH_SEGMENTS, 0.0f), m_segmentDraws.size());
+        m_segmentDraws.push_back(SegmentDraw{mesh.first, mesh.count, mesh.capacity, glm::vec4(color, 1.0f)});
+
+        // Slots that left the ring's live range keep their entry until they are written again
+        for(std::size_t slot : m_wrappingSegments) {
+            if((slot + mesh.capacity - mesh.first) % mesh.capacity >= mesh.count) continue;
+
+            glm::vec3 low(mesh.slots[slot].low), high(mesh.slots[slot].high);
+            pushInstance((low + high) * 0.5f + getWrapShift(low, high), high - low, color, true);
+        }
+    }
+
+    // Static boxes stay in their own buffer and are only uploaded again after they change
+    StaticBoxID addStaticBox(glm::vec3 position, glm::vec3 color, glm::vec3 size) {
+        m_staticInstances.push_back(CubeInstance());
+        updateStaticBox(m_staticInstances.size() - 1, position, color, size);
+        return m_staticInstances.size() - 1;
+    }
+
+    void updateStaticBox(StaticBoxID id, glm::vec3 position, glm::vec3 color, glm::vec3 size) {
+        CubeInstance& instance = m_staticInstances[id];
+        instance.position = glm::vec4(position, 0.0f);
+        instance.size = glm::vec4(size, 0.0f);
+        instance.color = glm::vec4(color, 1.0f);
+        m_staticDirty = true;
+    }
+
+    void clearStaticGeometry() {
+        m_staticInstances.clear();
+        m_staticDirty = true;
+    }
+
+    // Queues the static boxes inside the view frustum
+    void renderStaticGeometry() {
+        for(std::size_t i = 0; i < m_staticInstances.size(); i++) {
+            if(!isVisible(m_staticInstances[i])) {
+                m_staticStats.culledBoxes++;
+                continue;
+            }
+
+            // Equal keys keep their order, so visible neighbours stay adjacent and are drawn as one run
+            m_queue.push(RenderQueue::makeKey(m_pass, PROGRAM_CUBE, MESH_STATIC_BOX, 0.0f), i);
+            m_staticStats.drawnBoxes++;
+        }
+    }
+
+    void beginFrame() {
+        if(m_shaderWatcher != NULL) reloadShaders();
+
+        m_gpuTimer->beginFrame();
+    }
+
+    void clear(glm::vec3 color) {
+        m_gpuTimer->beginPass(PASS_CLEAR);
+        glClearColor(color.r, color.g, color.b, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        m_gpuTimer->endPass();
+    }
+
+    // Everything queued from here on is drawn and timed as part of pass
+    void setPass(GpuPass pass) {
+        m_pass = pass;
+    }
+
+    // Sorts the frame's commands and draws them
+    void present() {
+        submit();
+        m_gpuTimer->endFrame();
+    }
+
+    // One draw call per cube instead of one per queue; kept for benchmarking
+    void setInstanced(bool instanced) {
+        m_instanced = instanced;
+    }
+
+    bool isInstanced() const {
+        return m_instanced;
+    }
+
+    // Snakes drawn as box instances with per-instance attributes instead of pulled from the segment buffer; kept for benchmarking
+    void setVertexPulling(bool vertexPulling) {
+        // The segment buffer missed the patches while off, the next snake uploads it whole
+        if(vertexPulling && !m_vertexPulling) m_segmentCapacity = 0;
+        m_vertexPulling = vertexPulling;
+    }
+
+    bool isVertexPulling() const {
+        return m_vertexPulling;
+    }
+
+    // Draw calls of the last frame, a batch is drawn per call unless instancing is off
+    std::size_t getBatchCount() const {
+        return m_batchCount;
+    }
+
+    const StaticGeometryStats& getStaticGeometryStats() const {
+        return m_staticStats;
+    }
+
+    const StreamBufferStats& getInstanceStreamStats() const {
+        return m_instanceStream->getStats();
+    }
+
+    const GpuTimer* getGpuTimer() const {
+        return m_gpuTimer;
+    }
+
+    void setProjectionMatrix(glm::mat4 projection) {
+        m_camera->setProjection(projection);
+        m_frustum.update(projection * m_camera->getView());
+    }
+
+    void setViewMatrix(glm::mat4 view) {
+        m_camera->setView(view);
+        m_frustum.update(m_camera->getProjection() * view);
+    }
+
+private:
+    void setProgram(RenderProgram slot, Program* newProgram) {
+        delete m_programs[slot];
+        m_programs[slot] = newProgram;
+
+        // Nothing but the camera changes between draws, the rest is set once per program
+        GLuint programID = newProgram->getProgramID();
+        CameraBuffer::bindProgram(programID);
+        glUseProgram(programID);
+        glUniform2f(glGetUniformLocation(programID, "board"), Constants::BOARD_WIDTH, Constants::BOARD_HEIGHT);
+        glUniform1f(glGetUniformLocation(programID, "minOffset"), MIN_OFFSET);
+        glUniform1i(glGetUniformLocation(programID, "segments"), 0);
+        glUseProgram(0);
+
+        if(slot == PROGRAM_SEGMENT) {
+            m_segmentBaseLocation = glGetUniformLocation(programID, "segmentBase");
+            m_segmentColorLocation = glGetUniformLocation(programID, "segmentColor");
+            m_segmentCapacityLocation = glGetUniformLocation(programID, "segmentCapacity");
+        }
+    }
+
+    // Never waits for the compiler: the current program stays in use until the new one has linked
+    void reloadShaders() {
+        for(int i = 0; i < PROGRAM_COUNT; i++) {
+            Program*& pending = m_pendingPrograms[i];
+            if(pending == NULL || !pending->isBuildComplete()) continue;
+
+            if(pending->finishBuild()) {
+                setProgram((RenderProgram)i, pending);
+                std::cout << "Reloaded " << PROGRAM_VERTEX_SHADERS[i] << " and " << PROGRAM_FRAGMENT_SHADERS[i] << "\n";
+            } else {
+                std::cout << "Shader reload failed, keeping the old program: " << pending->getErrorMessage() << "\n";
+                delete pending;
+            }
+            pending = NULL;
+        }
+
+        if(m_shaderWatcher->takeSources(m_shaderSources)) {
+            for(int i = 0; i < PROGRAM_COUNT; i++) {
+                auto vertex = m_shaderSources.find(PROGRAM_VERTEX_SHADERS[i]);
+                auto fragment = m_shaderSources.find(PROGRAM_FRAGMENT_SHADERS[i]);
+                if(vertex == m_shaderSources.end() || fragment == m_shaderSources.end()) continue;
+
+                // A newer edit replaces a build that is still running
+                delete m_pendingPrograms[i];
+                m_pendingPrograms[i] = Program::beginBuild(ShaderSources{vertex->second, fragment->second});
+            }
+        }
+    }
+
+    // Where the part of a box over the board edge re-enters, zero for a box inside the board. A box
+    // over a corner is only wrapped along x.
+    static glm::vec3 getWrapShift(glm::vec3 low, glm::vec3 high) {
+        glm::vec3 shift(0.0f);
+        if(high.x > Constants::BOARD_WIDTH) shift.x = -2.0f * Constants::BOARD_WIDTH;
+        else if(low.x < -Constants::BOARD_WIDTH) shift.x = 2.0f * Constants::BOARD_WIDTH;
+        else if(high.z > Constants::BOARD_HEIGHT) shift.z = -2.0f * Constants::BOARD_HEIGHT;
+        else if(low.z < -Constants::BOARD_HEIGHT) shift.z = 2.0f * Constants::BOARD_HEIGHT;
+        return shift;
+    }
+
+    void updateWrappingSegment(const SnakeMeshView& mesh, std::size_t slot) {
+        if(getWrapShift(glm::vec3(mesh.slots[slot].low), glm::vec3(mesh.slots[slot].high)) != glm::vec3(0.0f)) m_wrappingSegments.insert(slot);
+        else m_wrappingSegments.erase(slot);
+    }
+
+    void pushInstance(const glm::vec3& position, const glm::vec3& size, const glm::vec3& color, bool wrap) {
+        CubeInstance instance;
+        instance.position = glm::vec4(position, wrap ? 1.0f : 0.0f);
+        instance.size = glm::vec4(size, 0.0f);
+        instance.color = glm::vec4(color, 1.0f);
+
+        // Front to back so the depth test rejects hidden fragments early
+        const glm::mat4& view = m_camera->getView();
+        float distance = -(view[0][2] * position.x + view[1][2] * position.y + view[2][2] * position.z + view[3][2]);
+
+        m_queue.push(RenderQueue::makeKey(m_pass, PROGRAM_CUBE, MESH_CUBE, distance / SORT_DEPTH_RANGE), m_instances.size());
+        m_instances.push_back(instance);
+    }
+
+    void submit() {
+        m_queue.sort();
+        if(m_staticDirty) uploadStaticGeometry();
+
+        std::size_t streamOffset = uploadInstances();
+
+        unsigned program = ~0u;
+        unsigned pass = PASS_COUNT;
+        for(const RenderBatch& batch : m_queue.getBatches()) {
+            if(RenderQueue::getPass(batch.key) != pass) {
+                if(pass != PASS_COUNT) m_gpuTimer->endPass();
+                pass = RenderQueue::getPass(batch.key);
+                m_gpuTimer->beginPass((GpuPass)pass);
+            }
+
+            if(RenderQueue::getProgram(batch.key) != program) {
+                program = RenderQueue::getProgram(batch.key);
+                useProgram((RenderProgram)program);
+            }
+
+            if(RenderQueue::getMesh(batch.key) == MESH_CUBE) {
+                drawInstances(m_instanceStream->getBufferID(), streamOffset, batch.count);
+                streamOffset += batch.count * sizeof(CubeInstance);
+            } else if(RenderQueue::getMesh(batch.key) == MESH_STATIC_BOX) {
+                drawStaticBoxes(batch);
+            } else {
+                drawSegments(batch);
+            }
+        }
+        if(pass != PASS_COUNT) m_gpuTimer->endPass();
+
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+        m_batchCount = m_queue.getBatches().size();
+        m_instanceStream->fence();
+        m_instances.clear();
+        m_segmentDraws.clear();
+        m_queue.clear();
+    }
+
+    // Copies the streamed instances into this frame's region of the ring in sorted order, so every
+    // batch reads a contiguous range. Returns where the first one starts in the buffer.
+    std::size_t uploadInstances() {
+        if(m_instances.empty()) return 0;
+
+        CubeInstance* mapped;
+        if(m_instances.size() > m_instanceCapacity) {
+            while(m_instanceCapacity < m_instances.size()) m_instanceCapacity *= 2;
+            mapped = (CubeInstance*)m_instanceStream->grow(m_instanceCapacity * sizeof(CubeInstance), 0);
+        } else {
+            mapped = (CubeInstance*)m_instanceStream->map(0);
+        }
+
+        for(const RenderCommand& command : m_queue.getCommands()) {
+            if(RenderQueue::getMesh(command.key) == MESH_CUBE) *mapped++ = m_instances[command.payload];
+        }
+
+        m_instanceStream->unmap();
+        return m_instanceStream->getFrameOffset();
+    }
+
+    // Batches keep static boxes in ascending order, consecutive IDs are drawn with one call
+    void drawStaticBoxes(const RenderBatch& batch) {
+        const std::vector<RenderCommand>& commands = m_queue.getCommands();
+
+        std::size_t runStart = batch.first;
+        for(std::size_t i = batch.first + 1; i <= batch.first + batch.count; i++) {
+            if(i < batch.first + batch.count && commands[i].payload == commands[i - 1].payload + 1) continue;
+
+            drawInstances(m_staticBuffer, commands[runStart].payload * sizeof(CubeInstance), i - runStart);
+            runStart = i;
+        }
+    }
+
+    // Pulled segments read no vertex attributes and get a VAO without any
+    void useProgram(RenderProgram slot) {
+        glUseProgram(m_programs[slot]->getProgramID());
+        m_camera->update();
+
+        if(slot == PROGRAM_SEGMENT) {
+            glBindVertexArray(m_emptyVAO);
+            glBindTexture(GL_TEXTURE_BUFFER, m_segmentTexture);
+        } else {
+            glBindVertexArray(VAO);
+        }
+    }
+
+    // 36 vertices per box
+    void drawSegments(const RenderBatch& batch) {
+        const std::vector<RenderCommand>& commands = m_queue.getCommands();
+        for(std::size_t i = batch.first; i < batch.first + batch.count; i++) {
+            const SegmentDraw& draw = m_segmentDraws[commands[i].payload];
+            glUniform1i(m_segmentBaseLocation, draw.first);
+            glUniform1i(m_segmentCapacityLocation, draw.capacity);
+            glUniform4fv(m_segmentColorLocation, 1, glm::value_ptr(draw.color));
+            glDrawArraysInstanced(GL_TRIANGLES, 0, CUBE_INDEX_COUNT, draw.count);
+        }
+    }
+
+    void drawInstances(GLuint buffer, std::size_t offset, std::size_t count) {
+        if(m_instanced) {
+            bindInstanceAttributes(buffer, offset);
+            glDrawElementsInstanced(GL_TRIANGLES, CUBE_INDEX_COUNT, GL_UNSIGNED_SHORT, (void*)0, count);
+            return;
+        }
+
+        for(std::size_t i = 0; i < count; i++) {
+            bindInstanceAttributes(buffer, offset + i * sizeof(CubeInstance));
+            glDrawElements(GL_TRIANGLES, CUBE_INDEX_COUNT, GL_UNSIGNED_SHORT, (void*)0);
+        }
+    }
+
+    // Regions of the stream move every frame and GL 4.1 has no base instance, so the pointers are re-set per draw
+    void bindInstanceAttributes(GLuint buffer, std::size_t offset) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glVertexAttribPointer(ATTRIB_INSTANCE_POSITION, 4, GL_FLOAT, GL_FALSE, sizeof(CubeInstance),
+                              (void*)(offset + offsetof(CubeInstance, position)));
+        glVertexAttribPointer(ATTRIB_INSTANCE_SIZE, 3, GL_FLOAT, GL_FALSE, sizeof(CubeInstance),
+                              (void*)(offset + offsetof(CubeInstance, size)));
+        glVertexAttribPointer(ATTRIB_COLOR, 4, GL_FLOAT, GL_FALSE, sizeof(CubeInstance),
+                              (void*)(offset + offsetof(CubeInstance, color)));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void uploadStaticGeometry() {
+        std::size_t size = m_staticInstances.size() * sizeof(CubeInstance);
+        if(m_staticBuffer == 0) glGenBuffers(1, &m_staticBuffer);
+
+        glBindBuffer(GL_ARRAY_BUFFER, m_staticBuffer);
+        if(size > m_staticBufferCapacity) {
+            glBufferData(GL_ARRAY_BUFFER, size, m_staticInstances.data(), GL_STATIC_DRAW);
+            m_staticBufferCapacity = size;
+        } else {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, size, m_staticInstances.data());
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        m_staticDirty = false;
+        m_staticStats.uploads++;
+    }
+
+    bool isVisible(const CubeInstance& instance) const {
+        return m_frustum.intersectsBox(glm::vec3(instance.position), glm::vec3(instance.size) * 0.5f);
+    }
+
+    void initBuffers() {
+        glGenVertexArrays(1, &m_emptyVAO);
+
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_VERTICES), CUBE_VERTICES, GL_STATIC_DRAW);
+
+        glGenBuffers(1, &EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(CUBE_INDICES), CUBE_INDICES, GL_STATIC_DRAW);
+
+        glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, CUBE_VERTEX_STRIDE * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(ATTRIB_POSITION);
+        glVertexAttribPointer(ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, CUBE_VERTEX_STRIDE * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(ATTRIB_NORMAL);
+
+        glVertexAttribDivisor(ATTRIB_INSTANCE_POSITION, 1);
+        glEnableVertexAttribArray(ATTRIB_INSTANCE_POSITION);
+        glVertexAttribDivisor(ATTRIB_INSTANCE_SIZE, 1);
+        glEnableVertexAttribArray(ATTRIB_INSTANCE_SIZE);
+        glVertexAttribDivisor(ATTRIB_COLOR, 1);
+        glEnableVertexAttribArray(ATTRIB_COLOR);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
+    enum Attribute {
+        ATTRIB_POSITION = 0,
+        ATTRIB_NORMAL = 1,
+        ATTRIB_INSTANCE_POSITION = 2,
+        ATTRIB_INSTANCE_SIZE = 3,
+        ATTRIB_COLOR = 4
+    };
+
+    Program* m_programs[PROGRAM_COUNT];
+    Program* m_pendingPrograms[PROGRAM_COUNT];
+    ShaderWatcher* m_shaderWatcher;
+    std::map<std::string, std::string> m_shaderSources;
+
+    RenderQueue m_queue;
+    std::vector<CubeInstance> m_instances;
+    GpuPass m_pass;
+    std::size_t m_batchCount;
+
+    StreamBuffer* m_instanceStream;
+    std::size_t m_instanceCapacity;
+
+    GpuTimer* m_gpuTimer;
+
+    bool m_instanced;
+    bool m_vertexPulling;
+
+    GLuint m_segmentBuffer;
+    std::size_t m_segmentCapacity;
+    std::vector<SegmentDraw> m_segmentDraws;
+    GLuint m_segmentTexture;
+    GLint m_segmentBaseLocation, m_segmentColorLocation, m_segmentCapacityLocation;
+    std::set<std::size_t> m_wrappingSegments; // ring slots whose box crosses the board edge
+
+    std::vector<CubeInstance> m_staticInstances;
+    GLuint m_staticBuffer;
+    std::size_t m_staticBufferCapacity;
+    bool m_staticDirty;
+    StaticGeometryStats m_staticStats;
+    Frustum m_frustum;
+
+    unsigned int VAO, VBO, EBO;
+    GLuint m_emptyVAO;
+
+    CameraBuffer* m_camera;
+};
+
+
+#endif // GLRENDERER_H_INCLUDED
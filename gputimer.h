@@ -0,0 +1,178 @@
+#ifndef GPUTIMER_H_INCLUDED
+#define GPUTIMER_H_INCLUDED
+
+#include <glad/glad.h>
+#include <chrono>
+#include <deque>
+#include <ostream>
+
+enum GpuPass {
+    PASS_CLEAR, PASS_SNAKE, PASS_APPLES, PASS_BOARD, PASS_COUNT
+};
+
+const char* const GPU_PASS_NAMES[PASS_COUNT] = {
+    "clear", "snake", "apples", "board"
+};
+
+// All times in milliseconds
+struct GpuFrameTimings {
+    unsigned long frame;
+    double passes[PASS_COUNT];
+    double gpuFrame;  // first to last timestamp of the frame
+    double cpuRender; // beginFrame to endFrame on the CPU
+    double cpuFrame;  // since the previous beginFrame
+};
+
+// Timer queries are read back LATENCY frames after they were issued and only
+// once the driver reports them available, so collecting never stalls. Frames
+// whose results still aren't ready when their slot comes around are dropped.
+class GpuTimer {
+public:
+    static const int LATENCY = 4;
+    static const std::size_t MAX_HISTORY = 36000;
+
+    GpuTimer(): m_slot(0), m_frame(0), m_dropped(0), m_started(false) {
+        for(int i = 0; i < LATENCY; i++) {
+            glGenQueries(PASS_COUNT, m_slots[i].elapsed);
+            glGenQueries(2, m_slots[i].timestamps);
+            m_slots[i].pending = false;
+        }
+    }
+
+    ~GpuTimer() {
+        for(int i = 0; i < LATENCY; i++) {
+            glDeleteQueries(PASS_COUNT, m_slots[i].elapsed);
+            glDeleteQueries(2, m_slots[i].timestamps);
+        }
+    }
+
+    void beginFrame() {
+        collect();
+
+        auto now = std::chrono::steady_clock::now();
+
+        Slot& slot = m_slots[m_slot];
+        if(slot.pending) {
+            m_dropped++;
+            slot.pending = false;
+        }
+
+        slot.timings.frame = m_frame;
+        slot.timings.cpuFrame = m_started ? milliseconds(now - m_lastFrameStart) : 0.0;
+        for(int pass = 0; pass < PASS_COUNT; pass++) slot.used[pass] = false;
+
+        m_started = true;
+        m_lastFrameStart = now;
+
+        glQueryCounter(slot.timestamps[0], GL_TIMESTAMP);
+    }
+
+    // Passes can't nest, GL allows a single active GL_TIME_ELAPSED query
+    void beginPass(GpuPass pass) {
+        Slot& slot = m_slots[m_slot];
+        slot.used[pass] = true;
+        glBeginQuery(GL_TIME_ELAPSED, slot.elapsed[pass]);
+    }
+
+    void endPass() {
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+
+    void endFrame() {
+        Slot& slot = m_slots[m_slot];
+        glQueryCounter(slot.timestamps[1], GL_TIMESTAMP);
+
+        slot.timings.cpuRender = milliseconds(std::chrono::steady_clock::now() - m_lastFrameStart);
+        slot.pending = true;
+
+        m_slot = (m_slot + 1) % LATENCY;
+        m_frame++;
+    }
+
+    const std::deque<GpuFrameTimings>& getResults() const { return m_results; }
+    unsigned long getDroppedFrames() const { return m_dropped; }
+
+    void writeCSV(std::ostream& out) const {
+        out << "frame";
+        for(int pass = 0; pass < PASS_COUNT; pass++) out << ",gpu_" << GPU_PASS_NAMES[pass] << "_ms";
+        out << ",gpu_frame_ms,cpu_render_ms,cpu_frame_ms\n";
+
+        for(auto& timings : m_results) {
+            out << timings.frame;
+            for(int pass = 0; pass < PASS_COUNT; pass++) out << "," << timings.passes[pass];
+            out << "," << timings.gpuFrame << "," << timings.cpuRender << "," << timings.cpuFrame << "\n";
+        }
+    }
+
+    void writeJSON(std::ostream& out) const {
+        out << "{\n  \"dropped_frames\": " << m_dropped << ",\n  \"frames\": [";
+
+        bool first = true;
+        for(auto& timings : m_results) {
+            out << (first ? "\n" : ",\n") << "    {\"frame\": " << timings.frame;
+            for(int pass = 0; pass < PASS_COUNT; pass++) {
+                out << ", \"gpu_" << GPU_PASS_NAMES[pass] << "_ms\": " << timings.passes[pass];
+            }
+            out << ", \"gpu_frame_ms\": " << timings.gpuFrame
+                << ", \"cpu_render_ms\": " << timings.cpuRender
+                << ", \"cpu_frame_ms\": " << timings.cpuFrame << "}";
+            first = false;
+        }
+
+        out << "\n  ]\n}\n";
+    }
+
+private:
+    struct Slot {
+        GLuint elapsed[PASS_COUNT];
+        GLuint timestamps[2];
+        bool used[PASS_COUNT];
+        bool pending;
+        GpuFrameTimings timings;
+    };
+
+    void collect() {
+        for(int i = 0; i < LATENCY; i++) {
+            Slot& slot = m_slots[(m_slot + i) % LATENCY];
+            if(!slot.pending) continue;
+
+            // The end timestamp is the last query of the frame, the others are done once it is
+            GLint available = 0;
+            glGetQueryObjectiv(slot.timestamps[1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if(!available) break;
+
+            GLuint64 value = 0;
+            for(int pass = 0; pass < PASS_COUNT; pass++) {
+                value = 0;
+                if(slot.used[pass]) glGetQueryObjectui64v(slot.elapsed[pass], GL_QUERY_RESULT, &value);
+                slot.timings.passes[pass] = value / 1e6;
+            }
+
+            GLuint64 start = 0, end = 0;
+            glGetQueryObjectui64v(slot.timestamps[0], GL_QUERY_RESULT, &start);
+            glGetQueryObjectui64v(slot.timestamps[1], GL_QUERY_RESULT, &end);
+            slot.timings.gpuFrame = (end - start) / 1e6;
+
+            m_results.push_back(slot.timings);
+            if(m_results.size() > MAX_HISTORY) m_results.pop_front();
+
+            slot.pending = false;
+        }
+    }
+
+    static double milliseconds(std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    Slot m_slots[LATENCY];
+    int m_slot;
+    unsigned long m_frame;
+    unsigned long m_dropped;
+
+    bool m_started;
+    std::chrono::steady_clock::time_point m_lastFrameStart;
+
+    std::deque<GpuFrameTimings> m_results;
+};
+
+#endif // GPUTIMER_H_INCLUDED
@@ -0,0 +1,108 @@
+#ifndef LATENCYTRACER_H_INCLUDED
+#define LATENCYTRACER_H_INCLUDED
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The turn the snake most recently applied, carried by every render snapshot
+// so a frame that skipped a snapshot still shows the turn. Times in seconds
+// on LatencyTracer::now().
+struct InputTrace {
+    unsigned long id = 0;
+    double keyTime = 0.0;
+    double applyTime = 0.0;
+};
+
+// Follows turn key presses from the GLFW callback through the simulation tick
+// that applies them to the first swap of a frame drawn from that tick. The
+// swap returning is as close to the photons as we can see from here; the
+// display adds its own scan-out and response time on top.
+//
+// Key events and ticks are traced on the simulation thread, frames on the
+// render thread. Each side only touches its own members.
+class LatencyTracer {
+public:
+    static double now() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Installs the key callback; the window's user pointer is taken over
+    void attach(GLFWwindow* window) {
+        glfwSetWindowUserPointer(window, this);
+        glfwSetKeyCallback(window, keyCallback);
+    }
+
+    double getKeyTime(int key) const {
+        return key >= 0 && key <= GLFW_KEY_LAST ? m_keyTimes[key] : now();
+    }
+
+    // A key asked for a new direction; a later request before the next tick replaces it
+    void turnRequested(double keyTime) {
+        m_pendingKeyTime = keyTime;
+        m_hasPendingTurn = true;
+    }
+
+    void turnApplied() {
+        if(!m_hasPendingTurn) return;
+
+        m_lastTurn.id++;
+        m_lastTurn.keyTime = m_pendingKeyTime;
+        m_lastTurn.applyTime = now();
+        m_hasPendingTurn = false;
+    }
+
+    const InputTrace& getLastTurn() const { return m_lastTurn; }
+
+    // Call right after the swap of a frame drawn from a snapshot carrying trace
+    void frameShown(const InputTrace& trace) {
+        if(trace.id <= m_lastShownTurn) return;
+        m_lastShownTurn = trace.id;
+
+        double shown = now();
+        m_keyToTick.push_back((trace.applyTime - trace.keyTime) * 1000.0);
+        m_tickToSwap.push_back((shown - trace.applyTime) * 1000.0);
+        m_keyToSwap.push_back((shown - trace.keyTime) * 1000.0);
+    }
+
+    void printReport(const std::string& configuration) const {
+        std::cout << "Input latency (" << configuration << "), " << m_keyToSwap.size() << " turns:\n";
+        if(m_keyToSwap.empty()) return;
+
+        printDistribution("  key to swap", m_keyToSwap);
+        printDistribution("  key to tick", m_keyToTick);
+        printDistribution("  tick to swap", m_tickToSwap);
+    }
+
+private:
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+        LatencyTracer* tracer = (LatencyTracer*)glfwGetWindowUserPointer(window);
+        if(action == GLFW_PRESS && key >= 0 && key <= GLFW_KEY_LAST) tracer->m_keyTimes[key] = now();
+    }
+
+    static void printDistribution(const char* name, std::vector<double> samples) {
+        std::sort(samples.begin(), samples.end());
+        std::cout << name << ": p50 " << percentile(samples, 0.50) << " ms, p95 " << percentile(samples, 0.95)
+                  << " ms, p99 " << percentile(samples, 0.99) << " ms\n";
+    }
+
+    static double percentile(const std::vector<double>& sorted, double fraction) {
+        return sorted[std::min(sorted.size() - 1, (std::size_t)(sorted.size() * fraction))];
+    }
+
+    double m_keyTimes[GLFW_KEY_LAST + 1] = {};
+    double m_pendingKeyTime = 0.0;
+    bool m_hasPendingTurn = false;
+    InputTrace m_lastTurn;
+
+    unsigned long m_lastShownTurn = 0;
+    std::vector<double> m_keyToTick;
+    std::vector<double> m_tickToSwap;
+    std::vector<double> m_keyToSwap;
+};
+
+#endif // LATENCYTRACER_H_INCLUDED
@@ -1,8 +1,95 @@
 #include "game.h"
 #include "common.h"
 
-int main() {
-    Game game("Snake3D", Constants::SCREEN_WIDTH, Constants::SCREEN_HEIGHT);
+#include <cstring>
+#include <cstdlib>
+
+std::string defaultShaderCacheDirectory() {
+    const char* cacheHome = std::getenv("XDG_CACHE_HOME");
+    if(cacheHome != NULL && cacheHome[0] != '\0') return std::string(cacheHome) + "/snake3d/shaders";
+
+    const char* home = std::getenv("HOME");
+    if(home != NULL && home[0] != '\0') return std::string(home) + "/.cache/snake3d/shaders";
+
+    return "";
+}
+
+int main(int argc, char** argv) {
+    GameOptions options;
+    options.shaderCacheDirectory = defaultShaderCacheDirectory();
+    bool renderThreadSet = false;
+    for(int i = 1; i < argc; i++) {
+        if(std::strcmp(argv[i], "--headless") == 0) {
+            options.headless = true;
+        } else if(std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            options.frameLimit = std::strtoul(argv[++i], NULL, 10);
+        } else if(std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            options.capturePath = argv[++i];
+        } else if(std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            options.recordPath = argv[++i];
+        } else if(std::strcmp(argv[i], "--gpu-timings") == 0 && i + 1 < argc) {
+            options.gpuTimingsPath = argv[++i];
+        } else if(std::strcmp(argv[i], "--shader-cache") == 0 && i + 1 < argc) {
+            options.shaderCacheDirectory = argv[++i];
+        } else if(std::strcmp(argv[i], "--no-shader-cache") == 0) {
+            options.shaderCacheDirectory.clear();
+        } else if(std::strcmp(argv[i], "--shader-dir") == 0 && i + 1 < argc) {
+            options.shaderDirectory = argv[++i];
+        } else if(std::strcmp(argv[i], "--vsync") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if(std::strcmp(mode, "on") == 0) options.presentMode = PRESENT_VSYNC;
+            else if(std::strcmp(mode, "off") == 0) options.presentMode = PRESENT_IMMEDIATE;
+            else if(std::strcmp(mode, "adaptive") == 0) options.presentMode = PRESENT_ADAPTIVE;
+            else {
+                std::cout << "Unknown vsync mode " << mode << ", expected on, off or adaptive\n";
+                return 1;
+            }
+        } else if(std::strcmp(argv[i], "--fps-limit") == 0 && i + 1 < argc) {
+            options.frameRateLimit = std::strtod(argv[++i], NULL);
+        } else if(std::strcmp(argv[i], "--no-delta-smoothing") == 0) {
+            options.smoothDelta = false;
+        } else if(std::strcmp(argv[i], "--latency") == 0) {
+            options.measureLatency = true;
+        } else if(std::strcmp(argv[i], "--software") == 0) {
+            options.softwareRenderer = true;
+        } else if(std::strcmp(argv[i], "--no-snake-merging") == 0) {
+            options.mergeSnakeRuns = false;
+        } else if(std::strcmp(argv[i], "--no-instancing") == 0) {
+            options.instancing = false;
+        } else if(std::strcmp(argv[i], "--no-vertex-pulling") == 0) {
+            options.vertexPulling = false;
+        } else if(std::strcmp(argv[i], "--render-thread") == 0 || std::strcmp(argv[i], "--single-thread") == 0) {
+            options.renderThread = std::strcmp(argv[i], "--render-thread") == 0;
+            renderThreadSet = true;
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--headless] [--frames N] [--capture frame.ppm] [--record frames.png|match.y4m] [--gpu-timings timings.csv|json]"
+                      << " [--shader-cache DIR | --no-shader-cache] [--shader-dir DIR] [--render-thread | --single-thread]"
+                      << " [--vsync on|off|adaptive] [--fps-limit N] [--no-delta-smoothing] [--latency] [--software] [--no-snake-merging]"
+                      << " [--no-instancing] [--no-vertex-pulling]\n";
+            return 1;
+        }
+    }
+
+    if(options.headless && options.frameLimit == 0) {
+        options.frameLimit = 600;
+    }
+
+    // Headless runs step a fixed delta per frame unless asked for the threaded loop
+    if(options.headless && !renderThreadSet) {
+        options.renderThread = false;
+    }
+
+    // A video plays back at a fixed rate, frames drawn as fast as they go have none
+    bool uncapped = options.frameRateLimit <= 0.0 && (options.headless ? options.renderThread : options.presentMode == PRESENT_IMMEDIATE);
+    std::size_t pathLength = options.recordPath.size();
+    if(uncapped && pathLength >= 4 && options.recordPath.compare(pathLength - 4, 4, ".y4m") == 0) {
+        std::cout << "Unable to record " << options.recordPath << " at an uncapped frame rate, give --fps-limit!\n";
+        return 1;
+    }
+
+    Game game("Snake3D", Constants::SCREEN_WIDTH, Constants::SCREEN_HEIGHT, options);
+    if(!game.isValid()) return -1;
+
     game.run();
 
     return 0;
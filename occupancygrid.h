@@ -0,0 +1,120 @@
+#ifndef OCCUPANCYGRID_H_INCLUDED
+#define OCCUPANCYGRID_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+#include "3rdparty/entt.hpp"
+
+// Which board cells the snakes' bodies cover, one bit a cell, kept up to date
+// as they move so a lookup is a bit test instead of a walk over every segment.
+// Segments are counted per cell since a snake's body can stack up on one, and
+// every cell remembers the snake that entered it last. Apples are indexed by
+// cell the same way, at most one a cell. Lives in the registry context.
+class OccupancyGrid {
+public:
+    OccupancyGrid(): m_columns(int(2.0f * Constants::BOARD_WIDTH / Constants::CELL_WIDTH)),
+        m_rows(int(2.0f * Constants::BOARD_HEIGHT / Constants::CELL_WIDTH)) {
+
+        m_bits.resize((m_columns * m_rows + 63) / 64, 0);
+        m_counts.resize(m_columns * m_rows, 0);
+        m_occupants.resize(m_columns * m_rows, entt::null);
+        m_appleBits.resize(m_bits.size(), 0);
+        m_apples.resize(m_columns * m_rows, entt::null);
+    }
+
+    int getColumns() const { return m_columns; }
+    int getRows() const { return m_rows; }
+    int getCellCount() const { return m_columns * m_rows; }
+
+    // Positions off the board wrap around like the snake does
+    int cellOf(glm::vec3 position) const {
+        int column = (int)std::floor(position.x / Constants::CELL_WIDTH + m_columns * 0.5f);
+        int row = (int)std::floor(position.z / Constants::CELL_WIDTH + m_rows * 0.5f);
+        column = ((column % m_columns) + m_columns) % m_columns;
+        row = ((row % m_rows) + m_rows) % m_rows;
+        return row * m_columns + column;
+    }
+
+    // Cell coordinates count cells from the board's centre, see Snake
+    int cellOf(glm::ivec3 cell) const {
+        return cellOf(glm::vec3(cell) * Constants::CELL_WIDTH);
+    }
+
+    // The cell's centre
+    glm::vec3 positionOf(int cell) const {
+        return glm::vec3((cell % m_columns - m_columns * 0.5f + 0.5f) * Constants::CELL_WIDTH, 0.0f,
+                         (cell / m_columns - m_rows * 0.5f + 0.5f) * Constants::CELL_WIDTH);
+    }
+
+    // Cell coordinates off the board come back in from the opposite edge
+    glm::ivec3 wrap(glm::ivec3 cell) const {
+        return glm::ivec3(glm::round(positionOf(cellOf(cell)) / Constants::CELL_WIDTH));
+    }
+
+    bool isOccupied(int cell) const {
+        return (m_bits[cell / 64] >> (cell % 64)) & 1;
+    }
+
+    // entt::null when the cell is free
+    entt::entity getOccupant(int cell) const {
+        return m_occupants[cell];
+    }
+
+    void add(int cell, entt::entity snake) {
+        if(m_counts[cell]++ == 0) m_bits[cell / 64] |= std::uint64_t(1) << (cell % 64);
+        m_occupants[cell] = snake;
+    }
+
+    void remove(int cell) {
+        if(--m_counts[cell] == 0) {
+            m_bits[cell / 64] &= ~(std::uint64_t(1) << (cell % 64));
+            m_occupants[cell] = entt::null;
+        }
+    }
+
+    // entt::null when there is no apple in the cell
+    entt::entity getApple(int cell) const {
+        return m_apples[cell];
+    }
+
+    void addApple(int cell, entt::entity apple) {
+        m_appleBits[cell / 64] |= std::uint64_t(1) << (cell % 64);
+        m_apples[cell] = apple;
+    }
+
+    void removeApple(int cell) {
+        m_appleBits[cell / 64] &= ~(std::uint64_t(1) << (cell % 64));
+        m_apples[cell] = entt::null;
+    }
+
+    // The first cell from cell on in row order, wrapping around, with neither a snake nor an apple in it;
+    // -1 when there is none
+    int findFreeCell(int cell) const {
+        int words = m_bits.size();
+        for(int i = 0; i <= words; i++) {
+            int word = (cell / 64 + i) % words;
+            std::uint64_t free = ~(m_bits[word] | m_appleBits[word]);
+
+            // The last pass comes back to the first word for the cells before cell
+            if(i == 0) free &= ~std::uint64_t(0) << (cell % 64);
+            if(word == words - 1 && getCellCount() % 64 != 0) free &= (std::uint64_t(1) << (getCellCount() % 64)) - 1;
+
+            if(free != 0) return word * 64 + __builtin_ctzll(free);
+        }
+        return -1;
+    }
+
+private:
+    int m_columns, m_rows;
+    std::vector<std::uint64_t> m_bits;
+    std::vector<unsigned int> m_counts;
+    std::vector<entt::entity> m_occupants;
+    std::vector<std::uint64_t> m_appleBits;
+    std::vector<entt::entity> m_apples;
+};
+
+#endif // OCCUPANCYGRID_H_INCLUDED
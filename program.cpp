@@ -1,33 +1,127 @@
 #include "program.h"
+#include "glextensions.h"
+#include "shaders/embedded.h"
 
-Program::Program(const std::string& vpath, const std::string& fpath):_hasError(false) {
+#include <cstdint>
+#include <cstdio>
+#include <cerrno>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::string Program::_binaryCacheDirectory;
+std::string Program::_sourceDirectory;
+
+Program::Program():_program(0), _vertexShader(0), _fragmentShader(0), _hasError(false), _fromBinaryCache(false), _buildPolls(0) {
+}
+
+Program::~Program() {
+    if(_vertexShader != 0) glDeleteShader(_vertexShader);
+    if(_fragmentShader != 0) glDeleteShader(_fragmentShader);
+    if(_program != 0) glDeleteProgram(_program);
+}
+
+Program::Program(const std::string& vpath, const std::string& fpath):Program() {
     generateProgram(vpath, fpath);
 }
+
+Program::Program(const ShaderSources& sources):Program() {
+    buildProgram(sources.vertex, sources.fragment);
+}
+
+Program* Program::load(const std::string& vertexShaderName, const std::string& fragmentShaderName) {
+    if(!_sourceDirectory.empty()) {
+        return new Program(_sourceDirectory + "/" + vertexShaderName, _sourceDirectory + "/" + fragmentShaderName);
+    }
+
+    return new Program(ShaderSources{EmbeddedShaders::find(vertexShaderName), EmbeddedShaders::find(fragmentShaderName)});
+}
 #include <iostream>
 bool Program::generateProgram(const std::string& vpath, const std::string& fpath) {
-    GLuint vertexShader = createShader(GL_VERTEX_SHADER, getSourceFromFile(vpath));
+    std::string vertexSource = getSourceFromFile(vpath);
+    std::string fragmentSource = getSourceFromFile(fpath);
+    return buildProgram(vertexSource, fragmentSource);
+}
+
+bool Program::buildProgram(std::string_view vertexSource, std::string_view fragmentSource) {
+    if(vertexSource.empty() || fragmentSource.empty()) {
+        _hasError = true;
+        _errorMessage = "Missing shader source";
+        return false;
+    }
+
+    std::string cachePath = getBinaryCachePath(vertexSource, fragmentSource);
+    if(!cachePath.empty() && loadProgramBinary(cachePath)) return true;
+
+    GLuint vertexShader = createShader(GL_VERTEX_SHADER, vertexSource);
     if(!checkShaderCompilationStatus(vertexShader)) return false;
 
-    GLuint fragmentShader = createShader(GL_FRAGMENT_SHADER, getSourceFromFile(fpath));
+    GLuint fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentSource);
     if(!checkShaderCompilationStatus(fragmentShader)) return false;
 
     _program = glCreateProgram();
     glAttachShader(_program, vertexShader);
     glAttachShader(_program, fragmentShader);
+    if(!cachePath.empty()) glProgramParameteri(_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(_program);
     if(!checkProgramCompilationStatus()) return false;
 
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
+    if(!cachePath.empty()) saveProgramBinary(cachePath);
+
     return true;
 }
 
-GLuint Program::createShader(GLenum type, const std::string& source) {
+Program* Program::beginBuild(const ShaderSources& sources) {
+    Program* program = new Program();
+
+    // No status queries here, they would wait for the compiler
+    program->_vertexShader = program->createShader(GL_VERTEX_SHADER, sources.vertex);
+    program->_fragmentShader = program->createShader(GL_FRAGMENT_SHADER, sources.fragment);
+
+    program->_program = glCreateProgram();
+    glAttachShader(program->_program, program->_vertexShader);
+    glAttachShader(program->_program, program->_fragmentShader);
+    glLinkProgram(program->_program);
+    program->_buildStart = std::chrono::steady_clock::now();
+
+    return program;
+}
+
+bool Program::isBuildComplete() {
+    // Without the extension there is no way to ask. Drivers still compile on their own threads, so
+    // the status query in finishBuild only comes once that has had a few frames and some time to run.
+    if(!GLExtensions::KHR_parallel_shader_compile) {
+        _buildPolls++;
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - _buildStart).count();
+        return _buildPolls > FALLBACK_BUILD_POLLS && elapsed >= FALLBACK_BUILD_TIME;
+    }
+
+    GLint complete = GL_FALSE;
+    glGetProgramiv(_program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+}
+
+bool Program::finishBuild() {
+    bool success = checkShaderCompilationStatus(_vertexShader) &&
+                   checkShaderCompilationStatus(_fragmentShader) &&
+                   checkProgramCompilationStatus();
+
+    glDeleteShader(_vertexShader);
+    glDeleteShader(_fragmentShader);
+    _vertexShader = _fragmentShader = 0;
+
+    return success;
+}
+
+GLuint Program::createShader(GLenum type, std::string_view source) {
     GLuint shader = glCreateShader(type);
 
-    const char* csource = source.c_str();
-    glShaderSource(shader, 1, &csource, NULL);
+    const char* csource = source.data();
+    GLint length = source.size();
+    glShaderSource(shader, 1, &csource, &length);
     glCompileShader(shader);
 
     return shader;
@@ -69,3 +163,102 @@ bool Program::checkProgramCompilationStatus() {
 
     return status == GL_TRUE;
 }
+
+void Program::setBinaryCacheDirectory(const std::string& directory) {
+    _binaryCacheDirectory = directory;
+
+    // Creates every missing component of the path
+    for(std::size_t slash = directory.find('/', 1); ; slash = directory.find('/', slash + 1)) {
+        std::string component = directory.substr(0, slash);
+        if(!component.empty() && mkdir(component.c_str(), 0755) != 0 && errno != EEXIST) {
+            _binaryCacheDirectory.clear();
+            return;
+        }
+        if(slash == std::string::npos) break;
+    }
+}
+
+static void hashBytes(std::uint64_t& hash, const char* bytes, std::size_t length) {
+    // FNV-1a
+    for(std::size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)bytes[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+static void hashString(std::uint64_t& hash, std::string_view string) {
+    hashBytes(hash, string.data(), string.size());
+    hashBytes(hash, "", 1);
+}
+
+static void hashString(std::uint64_t& hash, const GLubyte* string) {
+    hashString(hash, string != NULL ? std::string_view((const char*)string) : std::string_view());
+}
+
+std::string Program::getBinaryCachePath(std::string_view vertexSource, std::string_view fragmentSource) {
+    if(_binaryCacheDirectory.empty() || glProgramBinary == NULL || glGetProgramBinary == NULL) return "";
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if(formats == 0) return "";
+
+    // Binaries are only valid for the driver build that produced them
+    std::uint64_t hash = 14695981039346656037ULL;
+    hashString(hash, vertexSource);
+    hashString(hash, fragmentSource);
+    hashString(hash, glGetString(GL_VENDOR));
+    hashString(hash, glGetString(GL_RENDERER));
+    hashString(hash, glGetString(GL_VERSION));
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+    return _binaryCacheDirectory + "/" + name;
+}
+
+bool Program::loadProgramBinary(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if(!file) return false;
+
+    GLenum format = 0;
+    if(!file.read((char*)&format, sizeof(format))) return false;
+    std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if(binary.empty()) return false;
+
+    _program = glCreateProgram();
+    glProgramBinary(_program, format, binary.data(), binary.size());
+
+    // The driver may reject binaries after an update; a full compile follows then
+    GLint status = GL_FALSE;
+    glGetProgramiv(_program, GL_LINK_STATUS, &status);
+    if(status != GL_TRUE) {
+        glDeleteProgram(_program);
+        _program = 0;
+        std::remove(path.c_str());
+        return false;
+    }
+
+    _fromBinaryCache = true;
+    return true;
+}
+
+void Program::saveProgramBinary(const std::string& path) {
+    GLint length = 0;
+    glGetProgramiv(_program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(_program, length, NULL, &format, binary.data());
+
+    // Written under a temporary name, so a concurrently starting client never reads half a file
+    std::string temporaryPath = path + "." + std::to_string(getpid()) + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::binary);
+    if(!file) return;
+    file.write((const char*)&format, sizeof(format));
+    file.write(binary.data(), binary.size());
+    file.close();
+
+    if(!file || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::remove(temporaryPath.c_str());
+    }
+}
@@ -4,15 +4,42 @@
 #include <glad/glad.h>
 #include <GL/gl.h>
 
+#include <chrono>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <string_view>
+
+struct ShaderSources {
+    std::string_view vertex;
+    std::string_view fragment;
+};
 
 class Program {
 public:
     Program(const std::string& vertexShaderFile,
             const std::string& fragmentShaderFile);
 
+    // Compiles the given source text, no file I/O
+    explicit Program(const ShaderSources& sources);
+
+    ~Program();
+
+    // Loads shaders by file name (e.g. "vertex.glsl") from the source directory when one is set,
+    // otherwise from the sources embedded into the binary
+    static Program* load(const std::string& vertexShaderName,
+                         const std::string& fragmentShaderName);
+
+    // Queues compilation and linking without waiting for the driver. Poll isBuildComplete() once a
+    // frame and call finishBuild() once it returns true; finishBuild() reports whether the program is
+    // usable.
+    static Program* beginBuild(const ShaderSources& sources);
+    bool isBuildComplete();
+    bool finishBuild();
+
+    static void setSourceDirectory(const std::string& directory) { _sourceDirectory = directory; }
+    static const std::string& getSourceDirectory() { return _sourceDirectory; }
+
     bool generateProgram(const std::string& vertexShaderFile,
                          const std::string& fragmentShaderFile);
 
@@ -20,16 +47,46 @@ public:
     bool hasError() const { return _hasError; }
     const std::string& getErrorMessage() { return _errorMessage; }
 
+    // True when the program was restored from the binary cache instead of compiled
+    bool isFromBinaryCache() const { return _fromBinaryCache; }
+
+    // Linked programs are stored here and reused while the sources and the driver stay the same.
+    // An empty directory disables the cache.
+    static void setBinaryCacheDirectory(const std::string& directory);
+    static const std::string& getBinaryCacheDirectory() { return _binaryCacheDirectory; }
+
 private:
-    GLuint createShader(GLenum type, const std::string& source);
+    Program();
+
+    bool buildProgram(std::string_view vertexSource, std::string_view fragmentSource);
+
+    GLuint createShader(GLenum type, std::string_view source);
     bool checkShaderCompilationStatus(GLuint shader);
     bool checkProgramCompilationStatus();
 
     std::string getSourceFromFile(const std::string& fileName);
 
+    std::string getBinaryCachePath(std::string_view vertexSource, std::string_view fragmentSource);
+    bool loadProgramBinary(const std::string& path);
+    void saveProgramBinary(const std::string& path);
+
+    // Without KHR_parallel_shader_compile the driver can't be asked, a build is given this many polls
+    // and this long to finish in the background before its status is queried
+    static const int FALLBACK_BUILD_POLLS = 8;
+    static constexpr double FALLBACK_BUILD_TIME = 0.5;
+
     GLuint _program;
+    GLuint _vertexShader;
+    GLuint _fragmentShader;
     bool _hasError;
+    bool _fromBinaryCache;
     std::string _errorMessage;
+
+    int _buildPolls;
+    std::chrono::steady_clock::time_point _buildStart;
+
+    static std::string _binaryCacheDirectory;
+    static std::string _sourceDirectory;
 };
 
 
@@ -2,177 +2,75 @@
 #define RENDERER_H_INCLUDED
 
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include <deque>
+#include <cstddef>
+#include <vector>
 
-#include "program.h"
-#include "cube.h"
-
-using std::make_pair;
-using std::deque;
-using std::pair;
+#include "common.h"
+#include "gputimer.h"
 
+// Wrapped pieces of a box thinner than this aren't drawn
 const float MIN_OFFSET = 0.1f;
 
-class Renderer {
-public:
-    Renderer() {
-        program = new Program("shaders/vertex.glsl", "shaders/fragment.glsl");
-        uniformMVP = glGetUniformLocation(program->getProgramID(), "mvp");
-        uniformColor = glGetUniformLocation(program->getProgramID(), "color");
-
-        initBuffers();
-    }
-
-    ~Renderer() {
-        delete program;
-
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
-    }
-
-    void renderCube(glm::vec3 position, glm::vec3 color) {
-        if(position.x > Constants::BOARD_WIDTH - Constants::CELL_WIDTH * 0.5f) {
-            float sizex = std::max(Constants::BOARD_WIDTH - (position.x - Constants::CELL_WIDTH * 0.5f), 0.0f);
-
-            if(sizex > MIN_OFFSET) {
-                glm::mat4 mat = glm::translate(glm::mat4(1.0f), glm::vec3(Constants::BOARD_WIDTH - sizex*0.5f, position.y, position.z));
-                mat = glm::scale(mat, glm::vec3(sizex, Constants::CELL_WIDTH, Constants::CELL_WIDTH));
-                mat = glm::translate(mat, glm::vec3(0.0f, 0.0f, 0.0f));
-
-
-                m_cubesQueue.push_back(make_pair(mat, color));
-            }
-
-            if(Constants::CELL_WIDTH - sizex > MIN_OFFSET) {
-                glm::mat4 mat = glm::translate(glm::mat4(1.0f), glm::vec3(-Constants::BOARD_WIDTH + (Constants::CELL_WIDTH - sizex)*0.5f, position.y, position.z));
-                mat = glm::scale(mat, glm::vec3((Constants::CELL_WIDTH - sizex), Constants::CELL_WIDTH, Constants::CELL_WIDTH));
-                mat = glm::translate(mat, glm::vec3(0.0f, 0.0f, 0.0f));
-
-                m_cubesQueue.push_back(make_pair(mat, color));
-            }
-        } else if(position.x < -Constants::BOARD_WIDTH + Constants::CELL_WIDTH * 0.5f) {
-            float sizex = std::max((position.x + Constants::CELL_WIDTH * 0.5f) + Constants::BOARD_WIDTH, 0.0f);
-            if(sizex > 0.1f) {
-                glm::mat4 mat = glm::translate(glm::mat4(1.0f), glm::vec3(-Constants::BOARD_WIDTH + sizex*0.5f, position.y, position.z));
-                mat = glm::scale(mat, glm::vec3(sizex, Constants::CELL_WIDTH, Constants::CELL_WIDTH));
-                mat = glm::translate(mat, glm::vec3(0.0f, 0.0f, 0.0f));
-
-
-                m_cubesQueue.push_back(make_pair(mat, color));
-            }
-
-            if(Constants::CELL_WIDTH - sizex > MIN_OFFSET) {
-                glm::mat4 mat = glm::translate(glm::mat4(1.0f), glm::vec3(Constants::BOARD_WIDTH - (Constants::CELL_WIDTH - sizex)*0.5f, position.y, position.z));
-                mat = glm::scale(mat, glm::vec3((Constants::CELL_WIDTH - sizex), Constants::CELL_WIDTH, Constants::CELL_WIDTH));
-                mat = glm::translate(mat, glm::vec3(0.0f, 0.0f, 0.0f));
-
-                m_cubesQueue.push_back(make_pair(mat, color));
-            }
-        } else if(position.z > Constants::BOARD_HEIGHT - Constants::CELL_WIDTH * 0.5f) {
-            float sizez = std::max(Constants::BOARD_HEIGHT - (position.z - Constants::CELL_WIDTH * 0.5f), 0.0f);
-            if(sizez > MIN_OFFSET) {
-                glm::mat4 mat = glm::translate(glm::mat4(1.0f), glm::vec3(position.x, position.y, Constants::BOARD_HEIGHT - sizez*0.5f));
-                mat = glm::scale(mat, glm::vec3(Constants::CELL_WIDTH, Constants::CELL_WIDTH, sizez));
-                mat = glm::translate(mat, glm::vec3(0.0f, 0.0f, 0.0f));
-
-
-                m_cubesQueue.push_back(make_pair(mat, color));
-            }
-
-            if(Constants::CELL_WIDTH - sizez > 0.1f) {
-                glm::mat4 mat = glm::translate(glm::mat4(1.0f), glm::vec3(position.x, position.y, -Constants::BOARD_HEIGHT + (Constants::CELL_WIDTH - sizez)*0.5f));
-                mat = glm::scale(mat, glm::vec3(Constants::CELL_WIDTH, Constants::CELL_WIDTH, (Constants::CELL_WIDTH - sizez)));
-                mat = glm::translate(mat, glm::vec3(0.0f, 0.0f, 0.0f));
-
-                m_cubesQueue.push_back(make_pair(mat, color));
-            }
-        } else if(position.z < -Constants::BOARD_HEIGHT + Constants::CELL_WIDTH * 0.5f) {
-            float sizez = std::max((position.z + Constants::CELL_WIDTH * 0.5f) + Constants::BOARD_HEIGHT, 0.0f);
-            if(sizez > MIN_OFFSET) {
-                glm::mat4 mat = glm::translate(glm::mat4(1.0f), glm::vec3(position.x, position.y, -Constants::BOARD_HEIGHT + sizez*0.5f));
-                mat = glm::scale(mat, glm::vec3(Constants::CELL_WIDTH, Constants::CELL_WIDTH, sizez));
-                mat = glm::translate(mat, glm::vec3(0.0f, 0.0f, 0.0f));
+typedef std::size_t StaticBoxID;
 
+// Corners of a box, as two vec4 texels so the segment shader can fetch them directly
+struct SnakeBox {
+    glm::vec4 low;
+    glm::vec4 high;
+};
 
-                m_cubesQueue.push_back(make_pair(mat, color));
-            }
-
-            if(Constants::CELL_WIDTH - sizez > MIN_OFFSET) {
-                glm::mat4 mat = glm::translate(glm::mat4(1.0f), glm::vec3(position.x, position.y, Constants::BOARD_HEIGHT - (Constants::CELL_WIDTH - sizez)*0.5f));
-                mat = glm::scale(mat, glm::vec3(Constants::CELL_WIDTH, Constants::CELL_WIDTH, (Constants::CELL_WIDTH - sizez)));
-                mat = glm::translate(mat, glm::vec3(0.0f, 0.0f, 0.0f));
-
-                m_cubesQueue.push_back(make_pair(mat, color));
-            }
-        } else {
-            glm::mat4 mat = glm::translate(glm::mat4(1.0f), position);
-            mat = glm::scale(mat, glm::vec3(Constants::CELL_WIDTH, Constants::CELL_WIDTH, Constants::CELL_WIDTH));
-            m_cubesQueue.push_back(make_pair(mat, color));
-        }
+// The snake's boxes (see SnakeMesher): count of them from slot first on, in a
+// ring of capacity slots. A renderer keeping its own copy of the ring only has
+// to write the slots in dirty, unless rebuilt says the whole ring is new.
+struct SnakeMeshView {
+    const SnakeBox* slots;
+    std::size_t capacity;
+    std::size_t first;
+    std::size_t count;
+    const std::vector<IndexRange>* dirty;
+    bool rebuilt;
+};
 
-    }
+// Draws the frame's boxes. Everything queued between beginFrame and present
+// belongs to one frame; backends are free to draw any time before present
+// returns.
+class IRenderer {
+public:
+    virtual ~IRenderer() { }
 
-    void renderBox(glm::vec3 position, glm::vec3 color, glm::vec3 size) {
-        glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
-        model = glm::scale(model, size);
+    // Boxes crossing the board edge are split, the part outside re-enters from the opposite edge
+    virtual void renderWrappedBox(glm::vec3 position, glm::vec3 color, glm::vec3 size) = 0;
+    virtual void renderBox(glm::vec3 position, glm::vec3 color, glm::vec3 size) = 0;
 
-        m_cubesQueue.push_back(make_pair(model, color));
+    void renderCube(glm::vec3 position, glm::vec3 color) {
+        renderWrappedBox(position, color, glm::vec3(Constants::CELL_WIDTH));
     }
 
-    void present() {
-        glUseProgram(program->getProgramID());
-
-        glm::mat4 vp = m_projection * m_view;
-
-        for(auto cubeData : m_cubesQueue) {
-            glm::mat4 mvp = vp * cubeData.first;
-            glUniformMatrix4fv(uniformMVP, 1, GL_FALSE, glm::value_ptr(mvp));
-            glUniform4f(uniformColor, cubeData.second.x, cubeData.second.y, cubeData.second.z, 1.0f);
-
-            glBindVertexArray(VAO);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+    // Boxes wrapped like renderWrappedBox. A renderer may keep the ring between frames, so there is one snake per renderer.
+    virtual void renderSnake(const SnakeMeshView& mesh, glm::vec3 color) {
+        for(std::size_t i = 0; i < mesh.count; i++) {
+            const SnakeBox& box = mesh.slots[(mesh.first + i) % mesh.capacity];
+            glm::vec3 low(box.low), high(box.high);
+            renderWrappedBox((low + high) * 0.5f, color, high - low);
         }
-
-        m_cubesQueue.clear();
-    }
-
-    void setProjectionMatrix(glm::mat4 projection) {
-        m_projection = projection;
-    }
-
-    void setViewMatrix(glm::mat4 view) {
-        m_view = view;
     }
 
-private:
-    void initBuffers() {
-        glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
+    // Static boxes are kept by the renderer and drawn by renderStaticGeometry, skipping those out of view
+    virtual StaticBoxID addStaticBox(glm::vec3 position, glm::vec3 color, glm::vec3 size) = 0;
+    virtual void updateStaticBox(StaticBoxID id, glm::vec3 position, glm::vec3 color, glm::vec3 size) = 0;
+    virtual void clearStaticGeometry() = 0;
+    virtual void renderStaticGeometry() = 0;
 
-        glGenBuffers(1, &VBO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_VERTICIES), CUBE_VERTICIES, GL_STATIC_DRAW);
+    virtual void beginFrame() = 0;
+    virtual void clear(glm::vec3 color) = 0;
+    virtual void setPass(GpuPass pass) = 0;
+    virtual void present() = 0;
 
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
+    virtual void setProjectionMatrix(glm::mat4 projection) = 0;
+    virtual void setViewMatrix(glm::mat4 view) = 0;
 
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    }
-
-    Program* program;
-    deque<pair<glm::mat4, glm::vec3>> m_cubesQueue;
-
-    unsigned int VAO, VBO;
-    GLint uniformMVP;
-    GLint uniformColor;
-
-    glm::mat4 m_projection, m_view;
+    // Per-pass GPU times, available a few frames after they were rendered; NULL when not drawing on the GPU
+    virtual const GpuTimer* getGpuTimer() const { return NULL; }
 };
 
-
 #endif // RENDERER_H_INCLUDED
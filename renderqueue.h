@@ -0,0 +1,108 @@
+#ifndef RENDERQUEUE_H_INCLUDED
+#define RENDERQUEUE_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Key layout, most significant first, so sorting groups commands by pass,
+// then by GL state and draws each group front to back:
+//   pass:8 | program:8 | mesh:8 | depth:24 | unused:16
+struct RenderCommand {
+    std::uint64_t key;
+    std::uint32_t payload; // index into the payload array of the command's mesh
+};
+
+// Consecutive sorted commands sharing pass, program and mesh
+struct RenderBatch {
+    std::uint64_t key; // of the first command
+    std::size_t first;
+    std::size_t count;
+};
+
+// Commands are recorded in any order during the frame and sorted once before
+// submission. The arrays keep their capacity between frames, so a steady
+// scene doesn't allocate.
+class RenderQueue {
+public:
+    static const int STATE_SHIFT = 40;
+    static const int DEPTH_BITS = 24;
+
+    // depth in [0, 1], 0 being closest to the camera
+    static std::uint64_t makeKey(unsigned pass, unsigned program, unsigned mesh, float depth) {
+        if(depth < 0.0f) depth = 0.0f;
+        if(depth > 1.0f) depth = 1.0f;
+        std::uint64_t quantized = (std::uint64_t)(depth * ((1 << DEPTH_BITS) - 1));
+
+        return ((std::uint64_t)(pass & 0xFF) << 56) | ((std::uint64_t)(program & 0xFF) << 48) |
+               ((std::uint64_t)(mesh & 0xFF) << STATE_SHIFT) | (quantized << 16);
+    }
+
+    static unsigned getPass(std::uint64_t key) { return (key >> 56) & 0xFF; }
+    static unsigned getProgram(std::uint64_t key) { return (key >> 48) & 0xFF; }
+    static unsigned getMesh(std::uint64_t key) { return (key >> STATE_SHIFT) & 0xFF; }
+
+    void push(std::uint64_t key, std::uint32_t payload) {
+        m_commands.push_back(RenderCommand{ key, payload });
+    }
+
+    // Stable LSD radix sort on the keys followed by merging into batches
+    void sort() {
+        radixSort();
+
+        m_batches.clear();
+        for(std::size_t i = 0; i < m_commands.size(); i++) {
+            std::uint64_t key = m_commands[i].key;
+            if(m_batches.empty() || (m_batches.back().key >> STATE_SHIFT) != (key >> STATE_SHIFT)) {
+                m_batches.push_back(RenderBatch{ key, i, 0 });
+            }
+            m_batches.back().count++;
+        }
+    }
+
+    void clear() {
+        m_commands.clear();
+        m_batches.clear();
+    }
+
+    bool empty() const { return m_commands.empty(); }
+    std::size_t size() const { return m_commands.size(); }
+
+    const std::vector<RenderCommand>& getCommands() const { return m_commands; }
+    const std::vector<RenderBatch>& getBatches() const { return m_batches; }
+
+private:
+    void radixSort() {
+        std::size_t count = m_commands.size();
+        if(count < 2) return;
+
+        m_scratch.resize(count);
+
+        // The low 16 bits are never set
+        for(int shift = 16; shift < 64; shift += 8) {
+            std::size_t offsets[256] = {};
+            for(const RenderCommand& command : m_commands) offsets[(command.key >> shift) & 0xFF]++;
+
+            // Every key has the same digit, the pass wouldn't move anything
+            if(offsets[(m_commands[0].key >> shift) & 0xFF] == count) continue;
+
+            std::size_t sum = 0;
+            for(int digit = 0; digit < 256; digit++) {
+                std::size_t digitCount = offsets[digit];
+                offsets[digit] = sum;
+                sum += digitCount;
+            }
+
+            for(const RenderCommand& command : m_commands) {
+                m_scratch[offsets[(command.key >> shift) & 0xFF]++] = command;
+            }
+            m_commands.swap(m_scratch);
+        }
+    }
+
+    std::vector<RenderCommand> m_commands;
+    std::vector<RenderCommand> m_scratch;
+    std::vector<RenderBatch> m_batches;
+};
+
+#endif // RENDERQUEUE_H_INCLUDED
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Regenerates shaders/embedded.h from shaders/*.glsl; run from the project root.
+# The Code::Blocks project runs it before every build.
+
+output=shaders/embedded.h
+
+{
+    echo "// Generated by shaders/embed.sh from shaders/*.glsl, do not edit."
+    echo "#ifndef SHADERS_EMBEDDED_H_INCLUDED"
+    echo "#define SHADERS_EMBEDDED_H_INCLUDED"
+    echo ""
+    echo "#include <string_view>"
+    echo ""
+    echo "namespace EmbeddedShaders {"
+    echo "    struct Shader {"
+    echo "        std::string_view name;"
+    echo "        std::string_view source;"
+    echo "    };"
+    echo ""
+    echo "    constexpr Shader SHADERS[] = {"
+    for file in shaders/*.glsl; do
+        printf '        { "%s", R"glsl(' "$(basename "$file")"
+        cat "$file"
+        printf ')glsl" },\n'
+    done
+    echo "    };"
+    echo ""
+    echo "    // Empty when there is no shader with that file name"
+    echo "    constexpr std::string_view find(std::string_view name) {"
+    echo "        for(const Shader& shader : SHADERS) {"
+    echo "            if(shader.name == name) return shader.source;"
+    echo "        }"
+    echo "        return std::string_view();"
+    echo "    }"
+    echo "}"
+    echo ""
+    echo "#endif // SHADERS_EMBEDDED_H_INCLUDED"
+} > "$output.tmp"
+
+# Keep the timestamp when nothing changed so dependent files aren't rebuilt
+if cmp -s "$output.tmp" "$output"; then
+    rm "$output.tmp"
+else
+    mv "$output.tmp" "$output"
+fi
@@ -0,0 +1,150 @@
+// Generated by shaders/embed.sh from shaders/*.glsl, do not edit.
+#ifndef SHADERS_EMBEDDED_H_INCLUDED
+#define SHADERS_EMBEDDED_H_INCLUDED
+
+#include <string_view>
+
+namespace EmbeddedShaders {
+    struct Shader {
+        std::string_view name;
+        std::string_view source;
+    };
+
+    constexpr Shader SHADERS[] = {
+        { "fragment.glsl", R"glsl(#version 330 core
+
+in vec3 normal;
+in vec4 color;
+out vec4 outColor;
+
+const vec3 lightDirection = normalize(vec3(0.3f, 1.0f, 0.5f));
+const float ambient = 0.35f;
+
+void main() {
+    float diffuse = max(dot(normalize(normal), lightDirection), 0.0f);
+    outColor = vec4(color.rgb * (ambient + (1.0f - ambient) * diffuse), color.a);
+}
+)glsl" },
+        { "segment.glsl", R"glsl(#version 330 core
+
+// Snake boxes pulled from a texture buffer, two texels each: the low and
+// high corner (SnakeBox). The buffer is a ring of segmentCapacity boxes
+// starting at segmentBase. The box itself comes from gl_VertexID, drawn as 36
+// non-indexed vertices in the face order of cube.h.
+
+out vec3 normal;
+out vec4 color;
+
+// Shared by every program, see camerabuffer.h
+layout(std140) uniform Camera {
+        mat4 view;
+        mat4 projection;
+        mat4 viewProjection;
+};
+
+uniform samplerBuffer segments;
+uniform int segmentBase;
+uniform int segmentCapacity;
+uniform vec4 segmentColor;
+
+uniform vec2 board;
+uniform float minOffset;
+
+const vec4 DISCARDED = vec4(2.0, 2.0, 2.0, 1.0);
+
+const vec3 NORMALS[6] = vec3[6](
+        vec3(0.0, 0.0, -1.0), vec3(0.0, 0.0, 1.0), vec3(-1.0, 0.0, 0.0),
+        vec3(1.0, 0.0, 0.0), vec3(0.0, -1.0, 0.0), vec3(0.0, 1.0, 0.0)
+);
+
+const vec3 CORNERS[24] = vec3[24](
+        vec3(-0.5, -0.5, -0.5), vec3(-0.5,  0.5, -0.5), vec3( 0.5,  0.5, -0.5), vec3( 0.5, -0.5, -0.5),
+        vec3(-0.5, -0.5,  0.5), vec3( 0.5, -0.5,  0.5), vec3( 0.5,  0.5,  0.5), vec3(-0.5,  0.5,  0.5),
+        vec3(-0.5, -0.5, -0.5), vec3(-0.5, -0.5,  0.5), vec3(-0.5,  0.5,  0.5), vec3(-0.5,  0.5, -0.5),
+        vec3( 0.5, -0.5, -0.5), vec3( 0.5,  0.5, -0.5), vec3( 0.5,  0.5,  0.5), vec3( 0.5, -0.5,  0.5),
+        vec3(-0.5, -0.5, -0.5), vec3( 0.5, -0.5, -0.5), vec3( 0.5, -0.5,  0.5), vec3(-0.5, -0.5,  0.5),
+        vec3(-0.5,  0.5, -0.5), vec3(-0.5,  0.5,  0.5), vec3( 0.5,  0.5,  0.5), vec3( 0.5,  0.5, -0.5)
+);
+
+// Two triangles per face, same as CUBE_INDICES
+const int FACE_CORNERS[6] = int[6](0, 1, 2, 2, 3, 0);
+
+// Clipped to the board like the wrapping boxes of vertex.glsl; the renderer
+// draws the part of a box re-entering from the opposite edge as a box instance.
+void main() {
+        int box = (segmentBase + gl_InstanceID) % segmentCapacity;
+        vec3 low = texelFetch(segments, box * 2).xyz;
+        vec3 high = texelFetch(segments, box * 2 + 1).xyz;
+
+        low.xz = max(low.xz, -board);
+        high.xz = min(high.xz, board);
+        if(any(lessThan(high.xz - low.xz, vec2(minOffset)))) {
+                gl_Position = DISCARDED;
+                return;
+        }
+
+        int face = gl_VertexID / 6;
+        vec3 corner = CORNERS[face * 4 + FACE_CORNERS[gl_VertexID % 6]];
+
+        gl_Position = viewProjection * vec4(mix(low, high, corner + 0.5), 1.0);
+        normal = NORMALS[face];
+        color = segmentColor;
+}
+)glsl" },
+        { "vertex.glsl", R"glsl(#version 330 core
+
+layout(location = 0) in vec3 vPos;
+layout(location = 1) in vec3 vNormal;
+layout(location = 2) in vec4 iPosition;
+layout(location = 3) in vec3 iSize;
+layout(location = 4) in vec4 iColor;
+
+out vec3 normal;
+out vec4 color;
+
+// Shared by every program, see camerabuffer.h
+layout(std140) uniform Camera {
+        mat4 view;
+        mat4 projection;
+        mat4 viewProjection;
+};
+
+uniform vec2 board;
+uniform float minOffset;
+
+// Wrapping boxes (w of 1) are clipped to the board; the renderer adds a
+// second, shifted instance for the part of one that re-enters from the
+// opposite edge. Pieces thinner than minOffset collapse to a point outside
+// the clip volume.
+const vec4 DISCARDED = vec4(2.0, 2.0, 2.0, 1.0);
+
+void main() {
+        vec3 low = iPosition.xyz - iSize * 0.5;
+        vec3 high = iPosition.xyz + iSize * 0.5;
+
+        if(iPosition.w > 0.5) {
+                low.xz = max(low.xz, -board);
+                high.xz = min(high.xz, board);
+                if(any(lessThan(high.xz - low.xz, vec2(minOffset)))) {
+                        gl_Position = DISCARDED;
+                        return;
+                }
+        }
+
+        gl_Position = viewProjection * vec4(mix(low, high, vPos + 0.5), 1.0);
+        normal = vNormal;
+        color = iColor;
+}
+)glsl" },
+    };
+
+    // Empty when there is no shader with that file name
+    constexpr std::string_view find(std::string_view name) {
+        for(const Shader& shader : SHADERS) {
+            if(shader.name == name) return shader.source;
+        }
+        return std::string_view();
+    }
+}
+
+#endif // SHADERS_EMBEDDED_H_INCLUDED
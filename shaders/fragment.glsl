@@ -1,10 +1,13 @@
 #version 330 core
 
-in vec3 pos;
+in vec3 normal;
+in vec4 color;
 out vec4 outColor;
 
-uniform vec4 color;
+const vec3 lightDirection = normalize(vec3(0.3f, 1.0f, 0.5f));
+const float ambient = 0.35f;
 
 void main() {
-    outColor = color * (1.0f - pos.y);
+    float diffuse = max(dot(normalize(normal), lightDirection), 0.0f);
+    outColor = vec4(color.rgb * (ambient + (1.0f - ambient) * diffuse), color.a);
 }
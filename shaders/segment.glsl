@@ -0,0 +1,65 @@
+#version 330 core
+
+// Snake boxes pulled from a texture buffer, two texels each: the low and
+// high corner (SnakeBox). The buffer is a ring of segmentCapacity boxes
+// starting at segmentBase. The box itself comes from gl_VertexID, drawn as 36
+// non-indexed vertices in the face order of cube.h.
+
+out vec3 normal;
+out vec4 color;
+
+// Shared by every program, see camerabuffer.h
+layout(std140) uniform Camera {
+        mat4 view;
+        mat4 projection;
+        mat4 viewProjection;
+};
+
+uniform samplerBuffer segments;
+uniform int segmentBase;
+uniform int segmentCapacity;
+uniform vec4 segmentColor;
+
+uniform vec2 board;
+uniform float minOffset;
+
+const vec4 DISCARDED = vec4(2.0, 2.0, 2.0, 1.0);
+
+const vec3 NORMALS[6] = vec3[6](
+        vec3(0.0, 0.0, -1.0), vec3(0.0, 0.0, 1.0), vec3(-1.0, 0.0, 0.0),
+        vec3(1.0, 0.0, 0.0), vec3(0.0, -1.0, 0.0), vec3(0.0, 1.0, 0.0)
+);
+
+const vec3 CORNERS[24] = vec3[24](
+        vec3(-0.5, -0.5, -0.5), vec3(-0.5,  0.5, -0.5), vec3( 0.5,  0.5, -0.5), vec3( 0.5, -0.5, -0.5),
+        vec3(-0.5, -0.5,  0.5), vec3( 0.5, -0.5,  0.5), vec3( 0.5,  0.5,  0.5), vec3(-0.5,  0.5,  0.5),
+        vec3(-0.5, -0.5, -0.5), vec3(-0.5, -0.5,  0.5), vec3(-0.5,  0.5,  0.5), vec3(-0.5,  0.5, -0.5),
+        vec3( 0.5, -0.5, -0.5), vec3( 0.5,  0.5, -0.5), vec3( 0.5,  0.5,  0.5), vec3( 0.5, -0.5,  0.5),
+        vec3(-0.5, -0.5, -0.5), vec3( 0.5, -0.5, -0.5), vec3( 0.5, -0.5,  0.5), vec3(-0.5, -0.5,  0.5),
+        vec3(-0.5,  0.5, -0.5), vec3(-0.5,  0.5,  0.5), vec3( 0.5,  0.5,  0.5), vec3( 0.5,  0.5, -0.5)
+);
+
+// Two triangles per face, same as CUBE_INDICES
+const int FACE_CORNERS[6] = int[6](0, 1, 2, 2, 3, 0);
+
+// Clipped to the board like the wrapping boxes of vertex.glsl; the renderer
+// draws the part of a box re-entering from the opposite edge as a box instance.
+void main() {
+        int box = (segmentBase + gl_InstanceID) % segmentCapacity;
+        vec3 low = texelFetch(segments, box * 2).xyz;
+        vec3 high = texelFetch(segments, box * 2 + 1).xyz;
+
+        low.xz = max(low.xz, -board);
+        high.xz = min(high.xz, board);
+        if(any(lessThan(high.xz - low.xz, vec2(minOffset)))) {
+                gl_Position = DISCARDED;
+                return;
+        }
+
+        int face = gl_VertexID / 6;
+        vec3 corner = CORNERS[face * 4 + FACE_CORNERS[gl_VertexID % 6]];
+
+        gl_Position = viewProjection * vec4(mix(low, high, corner + 0.5), 1.0);
+        normal = NORMALS[face];
+        color = segmentColor;
+}
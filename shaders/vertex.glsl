@@ -1,12 +1,44 @@
 #version 330 core
 
 layout(location = 0) in vec3 vPos;
+layout(location = 1) in vec3 vNormal;
+layout(location = 2) in vec4 iPosition;
+layout(location = 3) in vec3 iSize;
+layout(location = 4) in vec4 iColor;
 
-out vec3 pos;
+out vec3 normal;
+out vec4 color;
 
-uniform mat4 mvp;
+// Shared by every program, see camerabuffer.h
+layout(std140) uniform Camera {
+        mat4 view;
+        mat4 projection;
+        mat4 viewProjection;
+};
+
+uniform vec2 board;
+uniform float minOffset;
+
+// Wrapping boxes (w of 1) are clipped to the board; the renderer adds a
+// second, shifted instance for the part of one that re-enters from the
+// opposite edge. Pieces thinner than minOffset collapse to a point outside
+// the clip volume.
+const vec4 DISCARDED = vec4(2.0, 2.0, 2.0, 1.0);
 
 void main() {
-        gl_Position = mvp * vec4(vPos, 1.0);
-        pos = vPos;
+        vec3 low = iPosition.xyz - iSize * 0.5;
+        vec3 high = iPosition.xyz + iSize * 0.5;
+
+        if(iPosition.w > 0.5) {
+                low.xz = max(low.xz, -board);
+                high.xz = min(high.xz, board);
+                if(any(lessThan(high.xz - low.xz, vec2(minOffset)))) {
+                        gl_Position = DISCARDED;
+                        return;
+                }
+        }
+
+        gl_Position = viewProjection * vec4(mix(low, high, vPos + 0.5), 1.0);
+        normal = vNormal;
+        color = iColor;
 }
@@ -0,0 +1,117 @@
+#ifndef SHADERWATCHER_H_INCLUDED
+#define SHADERWATCHER_H_INCLUDED
+
+#include <sys/inotify.h>
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Watches a shader directory with inotify on a background thread. Edited
+// *.glsl files are read there as well, so the render thread only picks up
+// finished sources and never touches the disk.
+class ShaderWatcher {
+public:
+    explicit ShaderWatcher(const std::string& directory): m_directory(directory), m_running(false), m_changed(false) {
+        m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(m_inotify < 0) {
+            std::cout << "Unable to start watching " << directory << " for shader changes!\n";
+            return;
+        }
+
+        // Editors either rewrite the file or move a new one over it
+        m_watch = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if(m_watch < 0) {
+            std::cout << "Unable to start watching " << directory << " for shader changes!\n";
+            close(m_inotify);
+            m_inotify = -1;
+            return;
+        }
+
+        m_running = true;
+        m_thread = std::thread(&ShaderWatcher::watch, this);
+    }
+
+    ~ShaderWatcher() {
+        m_running = false;
+        if(m_thread.joinable()) m_thread.join();
+        if(m_inotify >= 0) close(m_inotify);
+    }
+
+    // When any shader changed since the last call, copies the latest source of every shader, keyed by file name
+    bool takeSources(std::map<std::string, std::string>& sources) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_changed) return false;
+
+        sources = m_sources;
+        m_changed = false;
+        return true;
+    }
+
+    const std::string& getDirectory() const { return m_directory; }
+
+private:
+    void watch() {
+        // Unchanged files are needed as well when the other half of a program is edited
+        if(DIR* directory = opendir(m_directory.c_str())) {
+            while(dirent* entry = readdir(directory)) {
+                readSource(entry->d_name);
+            }
+            closedir(directory);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_changed = false;
+        }
+
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        pollfd descriptor = { m_inotify, POLLIN, 0 };
+
+        while(m_running) {
+            if(poll(&descriptor, 1, 100) <= 0) continue;
+
+            ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+            for(char* position = buffer; length > 0 && position < buffer + length; ) {
+                const inotify_event* event = (const inotify_event*)position;
+                position += sizeof(inotify_event) + event->len;
+
+                if(event->len > 0) readSource(event->name);
+            }
+        }
+    }
+
+    void readSource(const std::string& name) {
+        if(name.size() < 5 || name.compare(name.size() - 5, 5, ".glsl") != 0) return;
+
+        std::ifstream file(m_directory + "/" + name);
+        if(!file) return;
+        std::stringstream source;
+        source << file.rdbuf();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sources[name] = source.str();
+        m_changed = true;
+    }
+
+    std::string m_directory;
+    int m_inotify;
+    int m_watch;
+
+    std::atomic<bool> m_running;
+    std::thread m_thread;
+
+    std::mutex m_mutex;
+    std::map<std::string, std::string> m_sources;
+    bool m_changed;
+};
+
+#endif // SHADERWATCHER_H_INCLUDED
@@ -0,0 +1,81 @@
+#include "simulation.h"
+#include "common.h"
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Steps the game with a bot at the keys as fast as it goes, no window and no
+// GL, and reports how many ticks a second one core manages. A lost game starts
+// over on a fresh board.
+
+void resetBoard(entt::registry& registry) {
+    registry.clear();
+    registry.set<OccupancyGrid>();
+    createSnake(registry, glm::ivec3(0, 0, 0), Direction::TOP, 6);
+}
+
+int main(int argc, char** argv) {
+    unsigned long tickLimit = 10000000;
+    long seed = 1;
+    for(int i = 1; i < argc; i++) {
+        if(std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            tickLimit = std::strtoul(argv[++i], NULL, 10);
+        } else if(std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::strtol(argv[++i], NULL, 10);
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--ticks N] [--seed N]\n";
+            return 1;
+        }
+    }
+
+    if(tickLimit == 0) {
+        std::cout << "Unable to time the simulation without ticks, --ticks needs at least 1!\n";
+        return 1;
+    }
+
+    srand48(seed);
+
+    entt::registry registry;
+    entt::dispatcher dispatcher;
+    BotInputSystem botSystem;
+    MovingSystem movingSystem;
+    AppleSpawningSystem appleSpawningSystem;
+    resetBoard(registry);
+
+    unsigned long gamesLost = 0;
+    std::size_t longestSnake = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long tick = 0; tick < tickLimit; tick++) {
+        try {
+            botSystem.update(registry, dispatcher, TICK_TIME);
+            movingSystem.update(registry, dispatcher, TICK_TIME);
+            appleSpawningSystem.update(registry, dispatcher, TICK_TIME);
+        } catch(const std::logic_error&) {
+            registry.view<Snake>().each([&](entt::entity snake, Snake& snakeComponent) {
+                longestSnake = std::max(longestSnake, snakeComponent.parts.size());
+            });
+            gamesLost++;
+            resetBoard(registry);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    registry.view<Snake>().each([&](entt::entity snake, Snake& snakeComponent) {
+        longestSnake = std::max(longestSnake, snakeComponent.parts.size());
+    });
+
+    // ru_maxrss is in kilobytes on Linux
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::cout << "Simulation: " << tickLimit << " ticks in " << seconds << " s, "
+              << tickLimit / seconds << " ticks/s, " << seconds * 1e9 / tickLimit << " ns/tick\n";
+    std::cout << "Games: " << gamesLost << " lost, longest snake " << longestSnake << " segments\n";
+    std::cout << "Memory: " << usage.ru_maxrss << " KB peak resident\n";
+
+    return 0;
+}
@@ -0,0 +1,135 @@
+#ifndef SIMULATION_H_INCLUDED
+#define SIMULATION_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "common.h"
+#include "components.h"
+#include "occupancygrid.h"
+#include "3rdparty/entt.hpp"
+
+// The game's rules, free of the window and of GL so they can run on their own (see simrunner.cpp)
+
+struct GLFWwindow;
+
+// Seconds per simulation tick; the snake moves a cell a tick
+constexpr const double TICK_TIME = 0.3;
+
+class ISystem {
+public:
+    virtual ~ISystem() { }
+    virtual void update(entt::registry& registry, entt::dispatcher& dispatcher, double delta) { }
+    virtual void processInput(entt::registry& registry, entt::dispatcher& dispatcher, GLFWwindow* window) { }
+};
+
+// Puts a snake on the board that stretches to length cells over its first moves
+inline entt::entity createSnake(entt::registry& registry, glm::ivec3 cell, Direction direction, unsigned int length) {
+    entt::entity snake = registry.create();
+    registry.assign<Snake>(snake, cell, direction, 5.0f);
+
+    Snake& snakeComponent = registry.get<Snake>(snake);
+    for(unsigned int i = 2; i < length; i++) snakeComponent.grow();
+
+    OccupancyGrid& occupancy = registry.ctx<OccupancyGrid>();
+    for(std::size_t i = 0; i < snakeComponent.parts.size(); i++) occupancy.add(occupancy.cellOf(snakeComponent.parts[i]), snake);
+    return snake;
+}
+
+class AppleSpawningSystem: public ISystem {
+public:
+    void update(entt::registry& registry, entt::dispatcher& dispatcher, double delta) {
+        auto appleView = registry.view<Apple>();
+        if(appleView.size() < Constants::MAX_APPLES_COUNT) {
+            if(drand48() * 100.0f < Constants::APPLE_SPAWN_CHANCE) {
+                float randX = std::round( (drand48() - drand48()) * Constants::BOARD_WIDTH);
+                float randZ = std::round( (drand48() - drand48()) * Constants::BOARD_HEIGHT);
+
+                // Never under the snake or on another apple, the next free cell is taken instead
+                OccupancyGrid& occupancy = registry.ctx<OccupancyGrid>();
+                int cell = occupancy.findFreeCell(occupancy.cellOf(glm::vec3(randX, 0.0f, randZ)));
+                if(cell < 0) return;
+
+                auto apple = registry.create();
+                registry.assign<Apple>(apple, occupancy.positionOf(cell));
+                occupancy.addApple(cell, apple);
+            }
+        }
+
+    }
+};
+
+// Moves every snake a cell per call, the game calls it once a tick
+class MovingSystem: public ISystem {
+public:
+    void update(entt::registry& registry, entt::dispatcher& dispatcher, double delta) {
+        OccupancyGrid& occupancy = registry.ctx<OccupancyGrid>();
+        auto snakeView = registry.view<Snake>();
+        snakeView.each([&](entt::entity snake, Snake& snakeComponent) {
+            auto& parts = snakeComponent.parts;
+            glm::ivec3 head = occupancy.wrap(parts[0] + directionToVector(snakeComponent.movingDirection));
+            int headCell = occupancy.cellOf(head);
+
+            entt::entity apple = occupancy.getApple(headCell);
+            if(apple != entt::null) {
+                occupancy.removeApple(headCell);
+                registry.destroy(apple);
+                snakeComponent.grow();
+                //trigger event
+            }
+
+            // The tail leaves its cell as the head enters the next one, so the head may follow it in
+            glm::ivec3 tail = parts[parts.size() - 1];
+            if(snakeComponent.advance(head)) occupancy.remove(occupancy.cellOf(tail));
+
+            if(occupancy.isOccupied(headCell))
+                throw std::logic_error("You lose!");
+            occupancy.add(headCell, snake);
+        });
+
+    }
+};
+
+// Steers every snake towards the nearest apple, keeping clear of snakes while
+// there is a way around them. Stands in for the player where there is no one
+// at the keys.
+class BotInputSystem: public ISystem {
+public:
+    void update(entt::registry& registry, entt::dispatcher& dispatcher, double delta) {
+        OccupancyGrid& occupancy = registry.ctx<OccupancyGrid>();
+        auto appleView = registry.view<Apple>();
+        registry.view<Snake>().each([&](entt::entity snake, Snake& snakeComponent) {
+            Direction best = snakeComponent.movingDirection;
+            int bestScore = -1;
+            for(int i = 0; i < 4; i++) {
+                Direction direction = Direction(i);
+                if(direction == Direction((snakeComponent.movingDirection + 2) % 4)) continue;
+
+                glm::ivec3 next = occupancy.wrap(snakeComponent.parts[0] + directionToVector(direction));
+                int score = 0;
+                for(auto it = appleView.begin(); it != appleView.end(); ++it) {
+                    int distance = getDistance(occupancy, next, glm::ivec3(glm::round(appleView.get(*it).position / Constants::CELL_WIDTH)));
+                    if(it == appleView.begin() || distance < score) score = distance;
+                }
+                if(occupancy.isOccupied(occupancy.cellOf(next))) score += occupancy.getCellCount();
+
+                if(bestScore < 0 || score < bestScore) {
+                    best = direction;
+                    bestScore = score;
+                }
+            }
+            snakeComponent.movingDirection = best;
+        });
+    }
+
+private:
+    // Steps between two cells, the shorter way around the board's edges
+    static int getDistance(const OccupancyGrid& occupancy, glm::ivec3 from, glm::ivec3 to) {
+        int dx = std::abs(from.x - to.x), dz = std::abs(from.z - to.z);
+        return std::min(dx, occupancy.getColumns() - dx) + std::min(dz, occupancy.getRows() - dz);
+    }
+};
+
+#endif // SIMULATION_H_INCLUDED
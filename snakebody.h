@@ -0,0 +1,87 @@
+#ifndef SNAKEBODY_H_INCLUDED
+#define SNAKEBODY_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+#include "common.h"
+
+// A run of segments next to each other in memory
+struct SnakeBodySpan {
+    const glm::ivec3* data;
+    std::size_t size;
+};
+
+// The cells of the snake's segments from head (index 0) to tail in a ring, so
+// a move is a push at the head and a pop at the tail instead of copying every
+// segment up. The capacity is a power of two and only grows.
+class SnakeBody {
+public:
+    SnakeBody(): m_head(0), m_size(0) {
+        m_slots.resize(INITIAL_CAPACITY);
+    }
+
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    glm::ivec3& operator[](std::size_t index) { return m_slots[slot(index)]; }
+    const glm::ivec3& operator[](std::size_t index) const { return m_slots[slot(index)]; }
+
+    glm::ivec3& front() { return (*this)[0]; }
+    glm::ivec3& back() { return (*this)[m_size - 1]; }
+
+    void pushFront(glm::ivec3 segment) {
+        reserve(m_size + 1);
+        m_head = (m_head - 1) & (m_slots.size() - 1);
+        m_slots[m_head] = segment;
+        m_size++;
+    }
+
+    void pushBack(glm::ivec3 segment) {
+        reserve(m_size + 1);
+        m_slots[slot(m_size)] = segment;
+        m_size++;
+    }
+
+    void popBack() { m_size--; }
+
+    // Segments first to last as at most two spans, the second one only when the range wraps around the ring.
+    // Returns how many spans were written.
+    std::size_t getSpans(IndexRange range, SnakeBodySpan spans[2]) const {
+        std::size_t first = slot(range.first);
+        std::size_t count = range.last - range.first + 1;
+        std::size_t untilEnd = m_slots.size() - first;
+        if(count <= untilEnd) {
+            spans[0] = SnakeBodySpan{&m_slots[first], count};
+            return 1;
+        }
+
+        spans[0] = SnakeBodySpan{&m_slots[first], untilEnd};
+        spans[1] = SnakeBodySpan{&m_slots[0], count - untilEnd};
+        return 2;
+    }
+
+private:
+    static const std::size_t INITIAL_CAPACITY = 64;
+
+    std::size_t slot(std::size_t index) const { return (m_head + index) & (m_slots.size() - 1); }
+
+    void reserve(std::size_t size) {
+        if(size <= m_slots.size()) return;
+
+        std::size_t capacity = m_slots.size();
+        while(capacity < size) capacity *= 2;
+
+        std::vector<glm::ivec3> slots(capacity);
+        for(std::size_t i = 0; i < m_size; i++) slots[i] = (*this)[i];
+        m_slots.swap(slots);
+        m_head = 0;
+    }
+
+    std::vector<glm::ivec3> m_slots;
+    std::size_t m_head;
+    std::size_t m_size;
+};
+
+#endif // SNAKEBODY_H_INCLUDED
@@ -0,0 +1,355 @@
+#ifndef SNAKEMESHER_H_INCLUDED
+#define SNAKEMESHER_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "common.h"
+#include "renderer.h"
+
+struct SnakeMeshStats {
+    unsigned long frames = 0;
+    unsigned long segments = 0;
+    unsigned long boxes = 0;
+    unsigned long remeshedSegments = 0; // walked again because their box changed
+    unsigned long writtenBoxes = 0;     // slots a resident copy had to be patched with
+};
+
+// Turns the snake's unit cubes into as few boxes as possible before they are
+// handed to the renderer, the 1D case of greedy voxel meshing: walking the
+// segments in order, a cube that lines up with the current box on two axes
+// and touches or overlaps it on the third is folded into it. The union of the
+// two is still a box, so nothing is drawn that the cubes didn't cover.
+//
+// Boxes sticking out of the board are split again by the renderer, which only
+// shifts one copy across one edge; a cube that would make a box stick out on a
+// second side starts a new box instead. Neighbours across the board wrap are a
+// board apart and never touch, so runs end there by themselves.
+//
+// The mesher keeps its own copy of the segments and is fed only what changed.
+// Only boxes holding a changed segment are built again, and the boxes live in
+// a ring like the segments, so a new head box or a shorter tail leaves every
+// other box in its slot.
+class SnakeMesher {
+public:
+    // Positions closer than this are the same, segments are rounded to whole cells
+    static constexpr float EPSILON = 1e-3f;
+
+    SnakeMesher(): m_merging(true), m_shifts(0), m_length(0), m_segmentBase(0),
+        m_boxBase(0), m_boxCount(0), m_rebuilt(true) {
+
+        m_segments.resize(INITIAL_CAPACITY);
+        m_boxes.resize(INITIAL_CAPACITY);
+        m_spans.resize(INITIAL_CAPACITY);
+    }
+
+    // Without merging every segment becomes a box of its own; kept for benchmarking
+    void setMerging(bool merging) {
+        m_merging = merging;
+        m_boxCount = 0;
+    }
+
+    bool isMerging() const { return m_merging; }
+
+    // shifts counts every SegmentChanges::shift so far. dirty holds the segments that changed since some
+    // earlier update, in current indices and below length; values has their positions, range after range.
+    void update(unsigned long shifts, std::size_t length, const std::vector<IndexRange>& dirty, const glm::vec3* values) {
+        moveSegments(shifts - m_shifts, length);
+        m_shifts = shifts;
+        m_length = length;
+
+        for(const IndexRange& range : dirty) {
+            for(std::size_t i = range.first; i <= range.last; i++) segment(i) = *values++;
+        }
+
+        m_stats.frames++;
+        m_stats.segments += m_length;
+
+        if(m_length == 0) {
+            m_boxCount = 0;
+            return;
+        }
+
+        // Boxes past the tail are gone
+        while(m_boxCount > 0 && indexOf(span(m_boxCount - 1).first) >= m_length) m_boxCount--;
+
+        std::vector<IndexRange>& changed = m_changed;
+        changed = dirty;
+        if(m_boxCount == 0) {
+            addIndexRange(changed, IndexRange{0, m_length - 1});
+        } else {
+            // New segments no box holds yet, and the tail box when the tail was cut off inside it
+            std::size_t head = indexOf(span(0).first), tail = indexOf(span(m_boxCount - 1).last);
+            if(head > 0) addIndexRange(changed, IndexRange{0, head - 1});
+            if(tail + 1 < m_length) addIndexRange(changed, IndexRange{tail + 1, m_length - 1});
+            if(tail >= m_length) addIndexRange(changed, IndexRange{m_length - 1, m_length - 1});
+        }
+
+        // Boxes to build again, expanded to whole boxes; neighbouring ones are built together
+        std::vector<Rebuild>& rebuilds = m_rebuilds;
+        rebuilds.clear();
+        for(const IndexRange& range : changed) {
+            Rebuild rebuild;
+            rebuild.firstBox = findFirstBoxEndingAtOrAfter(range.first);
+            rebuild.endBox = findFirstBoxStartingAfter(range.last);
+            rebuild.segments = range;
+            if(rebuild.firstBox < rebuild.endBox) {
+                rebuild.segments.first = std::min(range.first, indexOf(span(rebuild.firstBox).first));
+                rebuild.segments.last = std::max(range.last, std::min(indexOf(span(rebuild.endBox - 1).last), m_length - 1));
+            }
+
+            if(!rebuilds.empty() && rebuild.firstBox <= rebuilds.back().endBox && rebuilds.back().endBox > rebuilds.back().firstBox) {
+                rebuilds.back().endBox = std::max(rebuilds.back().endBox, rebuild.endBox);
+                rebuilds.back().segments.last = std::max(rebuilds.back().segments.last, rebuild.segments.last);
+            } else {
+                rebuilds.push_back(rebuild);
+            }
+        }
+
+        // From the tail forward, so a rebuild never moves the boxes of one still to come
+        for(std::size_t i = rebuilds.size(); i-- > 0;) {
+            const Rebuild& rebuild = rebuilds[i];
+            build(rebuild.segments, m_fresh);
+            replaceBoxes(rebuild.firstBox, rebuild.endBox, m_fresh);
+        }
+
+        m_stats.boxes += m_boxCount;
+    }
+
+    SnakeMeshView getView() const {
+        return SnakeMeshView{m_boxes.data(), m_boxes.size(), m_boxBase & (m_boxes.size() - 1), m_boxCount, &m_dirtySlots, m_rebuilt};
+    }
+
+    // Call once a renderer has taken the view
+    void clearDirty() {
+        if(m_rebuilt) {
+            m_stats.writtenBoxes += m_boxCount;
+        } else {
+            for(const IndexRange& range : m_dirtySlots) m_stats.writtenBoxes += range.last - range.first + 1;
+        }
+
+        m_dirtySlots.clear();
+        m_rebuilt = false;
+    }
+
+    const SnakeMeshStats& getStats() const { return m_stats; }
+
+    void printReport() const {
+        if(m_stats.frames == 0) return;
+        std::cout << "Snake mesh" << (m_merging ? "" : " (merging off)") << ": "
+                  << (double)m_stats.segments / m_stats.frames << " segments drawn as "
+                  << (double)m_stats.boxes / m_stats.frames << " boxes per frame, "
+                  << (double)m_stats.remeshedSegments / m_stats.frames << " segments meshed and "
+                  << (double)m_stats.writtenBoxes / m_stats.frames << " boxes written per frame\n";
+    }
+
+private:
+    static const std::size_t INITIAL_CAPACITY = 64;
+
+    // Segment IDs stay with a segment as it moves up, index = ID + shifts
+    struct BoxSpan {
+        long long first;
+        long long last;
+    };
+
+    struct FreshBox {
+        SnakeBox box;
+        BoxSpan span;
+    };
+
+    // Boxes [firstBox, endBox) are replaced by the boxes built from segments
+    struct Rebuild {
+        std::size_t firstBox, endBox;
+        IndexRange segments;
+    };
+
+    glm::vec3& segment(std::size_t index) { return m_segments[(m_segmentBase + index) & (m_segments.size() - 1)]; }
+
+    std::size_t slot(std::size_t box) const { return (m_boxBase + box) & (m_boxes.size() - 1); }
+    const BoxSpan& span(std::size_t box) const { return m_spans[slot(box)]; }
+
+    long long idOf(std::size_t index) const { return (long long)index - (long long)m_shifts; }
+    std::size_t indexOf(long long id) const { return (std::size_t)(id + (long long)m_shifts); }
+
+    // Applies shifts to the segment ring, so every segment index moves up by that much
+    void moveSegments(unsigned long shifts, std::size_t length) {
+        if(length <= m_segments.size()) {
+            m_segmentBase -= shifts;
+            return;
+        }
+
+        std::size_t capacity = m_segments.size();
+        while(capacity < length) capacity *= 2;
+
+        std::vector<glm::vec3> segments(capacity);
+        for(std::size_t i = 0; i < m_length && i + shifts < length; i++) segments[i + shifts] = segment(i);
+        m_segments.swap(segments);
+        m_segmentBase = 0;
+    }
+
+    // Boxes are in ascending ID order, binary searches over the ring
+    std::size_t findFirstBoxEndingAtOrAfter(std::size_t index) const {
+        std::size_t low = 0, high = m_boxCount;
+        while(low < high) {
+            std::size_t middle = (low + high) / 2;
+            if(span(middle).last < idOf(index)) low = middle + 1;
+            else high = middle;
+        }
+        return low;
+    }
+
+    std::size_t findFirstBoxStartingAfter(std::size_t index) const {
+        std::size_t low = 0, high = m_boxCount;
+        while(low < high) {
+            std::size_t middle = (low + high) / 2;
+            if(span(middle).first <= idOf(index)) low = middle + 1;
+            else high = middle;
+        }
+        return low;
+    }
+
+    void build(IndexRange segments, std::vector<FreshBox>& boxes) {
+        boxes.clear();
+
+        glm::vec3 half(Constants::CELL_WIDTH * 0.5f);
+        for(std::size_t i = segments.first; i <= segments.last; i++) {
+            glm::vec3 low = segment(i) - half;
+            glm::vec3 high = segment(i) + half;
+
+            if(m_merging && !boxes.empty() && merge(boxes.back().box, low, high)) {
+                boxes.back().span.last = idOf(i);
+                continue;
+            }
+            boxes.push_back(FreshBox{SnakeBox{glm::vec4(low, 0.0f), glm::vec4(high, 0.0f)}, BoxSpan{idOf(i), idOf(i)}});
+        }
+
+        m_stats.remeshedSegments += segments.last - segments.first + 1;
+    }
+
+    void replaceBoxes(std::size_t firstBox, std::size_t endBox, std::vector<FreshBox>& boxes) {
+        // A box built on its own may fit onto the unchanged one next to it
+        if(m_merging && firstBox > 0 && merge(boxes.front().box, m_boxes[slot(firstBox - 1)])) {
+            firstBox--;
+            boxes.front().span.first = span(firstBox).first;
+        }
+        if(m_merging && endBox < m_boxCount && merge(boxes.back().box, m_boxes[slot(endBox)])) {
+            boxes.back().span.last = span(endBox).last;
+            endBox++;
+        }
+
+        if(firstBox == 0) {
+            // The head end of the ring moves, the boxes behind keep their slots
+            m_boxBase += endBox;
+            m_boxCount -= endBox;
+            reserveBoxes(m_boxCount + boxes.size());
+
+            for(std::size_t i = boxes.size(); i-- > 0;) {
+                m_boxBase--;
+                m_boxCount++;
+                writeBox(0, boxes[i]);
+            }
+            return;
+        }
+
+        m_kept.clear();
+        for(std::size_t i = endBox; i < m_boxCount; i++) m_kept.push_back(FreshBox{m_boxes[slot(i)], span(i)});
+
+        m_boxCount = firstBox;
+        reserveBoxes(m_boxCount + boxes.size() + m_kept.size());
+        for(const FreshBox& box : boxes) writeBox(m_boxCount++, box);
+        for(const FreshBox& box : m_kept) writeBox(m_boxCount++, box);
+    }
+
+    // Slots only count as dirty when their contents change
+    void writeBox(std::size_t box, const FreshBox& fresh) {
+        std::size_t index = slot(box);
+        m_spans[index] = fresh.span;
+        if(std::memcmp(&m_boxes[index], &fresh.box, sizeof(SnakeBox)) == 0) return;
+
+        m_boxes[index] = fresh.box;
+        if(!m_rebuilt) addIndexRange(m_dirtySlots, IndexRange{index, index});
+    }
+
+    void reserveBoxes(std::size_t count) {
+        if(count <= m_boxes.size()) return;
+
+        std::size_t capacity = m_boxes.size();
+        while(capacity < count) capacity *= 2;
+
+        std::vector<SnakeBox> boxes(capacity);
+        std::vector<BoxSpan> spans(capacity);
+        for(std::size_t i = 0; i < m_boxCount; i++) {
+            boxes[i] = m_boxes[slot(i)];
+            spans[i] = span(i);
+        }
+        m_boxes.swap(boxes);
+        m_spans.swap(spans);
+        m_boxBase = 0;
+
+        m_rebuilt = true;
+        m_dirtySlots.clear();
+    }
+
+    static bool merge(SnakeBox& box, const SnakeBox& other) {
+        return merge(box, glm::vec3(other.low), glm::vec3(other.high));
+    }
+
+    static bool merge(SnakeBox& box, const glm::vec3& low, const glm::vec3& high) {
+        for(int axis = 0; axis < 3; axis++) {
+            if(!isAlignedExcept(box, low, high, axis)) continue;
+            if(low[axis] > box.high[axis] + EPSILON || high[axis] < box.low[axis] - EPSILON) continue;
+
+            glm::vec3 mergedLow = glm::min(glm::vec3(box.low), low);
+            glm::vec3 mergedHigh = glm::max(glm::vec3(box.high), high);
+            if(countOverhangs(mergedLow, mergedHigh) > 1) return false;
+
+            box.low = glm::vec4(mergedLow, 0.0f);
+            box.high = glm::vec4(mergedHigh, 0.0f);
+            return true;
+        }
+
+        return false;
+    }
+
+    static bool isAlignedExcept(const SnakeBox& box, const glm::vec3& low, const glm::vec3& high, int axis) {
+        for(int other = 0; other < 3; other++) {
+            if(other == axis) continue;
+            if(glm::abs(box.low[other] - low[other]) > EPSILON || glm::abs(box.high[other] - high[other]) > EPSILON) return false;
+        }
+        return true;
+    }
+
+    // Board edges the box reaches past
+    static int countOverhangs(const glm::vec3& low, const glm::vec3& high) {
+        return (low.x < -Constants::BOARD_WIDTH - EPSILON) + (high.x > Constants::BOARD_WIDTH + EPSILON) +
+               (low.z < -Constants::BOARD_HEIGHT - EPSILON) + (high.z > Constants::BOARD_HEIGHT + EPSILON);
+    }
+
+    bool m_merging;
+
+    unsigned long m_shifts;
+    std::size_t m_length;
+    std::vector<glm::vec3> m_segments; // ring, power of two
+    std::size_t m_segmentBase;
+
+    std::vector<SnakeBox> m_boxes;     // ring, power of two
+    std::vector<BoxSpan> m_spans;      // segments of the box in the same slot
+    std::size_t m_boxBase;
+    std::size_t m_boxCount;
+
+    std::vector<IndexRange> m_dirtySlots;
+    bool m_rebuilt;
+
+    // Scratch, kept for its capacity
+    std::vector<IndexRange> m_changed;
+    std::vector<Rebuild> m_rebuilds;
+    std::vector<FreshBox> m_fresh;
+    std::vector<FreshBox> m_kept;
+
+    SnakeMeshStats m_stats;
+};
+
+#endif // SNAKEMESHER_H_INCLUDED
@@ -0,0 +1,433 @@
+#include "softwarerenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SOFTWARE_RENDERER_X86
+#endif
+
+namespace {
+    // Same lighting as fragment.glsl, evaluated once per face
+    const glm::vec3 LIGHT_DIRECTION = glm::normalize(glm::vec3(0.3f, 1.0f, 0.5f));
+    const float AMBIENT = 0.35f;
+
+    std::uint32_t packColor(const glm::vec3& color) {
+        glm::vec3 clamped = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+        return (std::uint32_t)clamped.r | ((std::uint32_t)clamped.g << 8) | ((std::uint32_t)clamped.b << 16) | 0xFF000000u;
+    }
+}
+
+SoftwareRenderer::SoftwareRenderer(int width, int height, unsigned threadCount):
+    m_width(width), m_height(height), m_avx2(false),
+    m_clearColor(0xFF000000u), m_clearRequested(false), m_pool(threadCount) {
+
+    // Rows are padded so the last SIMD step of a row never leaves it
+    m_stride = (width + 7) & ~7;
+    m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    m_color.assign(m_stride * height, m_clearColor);
+    m_depth.assign(m_stride * height, 1.0f);
+    m_bins.resize(m_tilesX * m_tilesY);
+
+#ifdef SOFTWARE_RENDERER_X86
+    m_avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLint readFramebuffer;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+    if(glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "Unable to create the software renderer's blit framebuffer!\n";
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+}
+
+SoftwareRenderer::~SoftwareRenderer() {
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteTextures(1, &m_texture);
+}
+
+// Same split as vertex.glsl: the box is clipped to the board and the part outside re-enters from the opposite edge
+void SoftwareRenderer::renderWrappedBox(glm::vec3 position, glm::vec3 color, glm::vec3 size) {
+    glm::vec3 low = position - size * 0.5f;
+    glm::vec3 high = position + size * 0.5f;
+
+    glm::vec3 shift(0.0f);
+    if(high.x > Constants::BOARD_WIDTH) shift.x = -2.0f * Constants::BOARD_WIDTH;
+    else if(low.x < -Constants::BOARD_WIDTH) shift.x = 2.0f * Constants::BOARD_WIDTH;
+    else if(high.z > Constants::BOARD_HEIGHT) shift.z = -2.0f * Constants::BOARD_HEIGHT;
+    else if(low.z < -Constants::BOARD_HEIGHT) shift.z = 2.0f * Constants::BOARD_HEIGHT;
+
+    for(int copy = 0; copy < (shift == glm::vec3(0.0f) ? 1 : 2); copy++) {
+        glm::vec3 pieceLow = low + (copy == 1 ? shift : glm::vec3(0.0f));
+        glm::vec3 pieceHigh = high + (copy == 1 ? shift : glm::vec3(0.0f));
+
+        pieceLow.x = std::max(pieceLow.x, -Constants::BOARD_WIDTH);
+        pieceLow.z = std::max(pieceLow.z, -Constants::BOARD_HEIGHT);
+        pieceHigh.x = std::min(pieceHigh.x, Constants::BOARD_WIDTH);
+        pieceHigh.z = std::min(pieceHigh.z, Constants::BOARD_HEIGHT);
+        if(pieceHigh.x - pieceLow.x < MIN_OFFSET || pieceHigh.z - pieceLow.z < MIN_OFFSET) continue;
+
+        queueBox(pieceLow, pieceHigh, color);
+    }
+}
+
+void SoftwareRenderer::renderBox(glm::vec3 position, glm::vec3 color, glm::vec3 size) {
+    queueBox(position - size * 0.5f, position + size * 0.5f, color);
+}
+
+StaticBoxID SoftwareRenderer::addStaticBox(glm::vec3 position, glm::vec3 color, glm::vec3 size) {
+    m_staticBoxes.push_back(Box());
+    updateStaticBox(m_staticBoxes.size() - 1, position, color, size);
+    return m_staticBoxes.size() - 1;
+}
+
+void SoftwareRenderer::updateStaticBox(StaticBoxID id, glm::vec3 position, glm::vec3 color, glm::vec3 size) {
+    m_staticBoxes[id] = Box{ position - size * 0.5f, position + size * 0.5f, color };
+}
+
+void SoftwareRenderer::clearStaticGeometry() {
+    m_staticBoxes.clear();
+}
+
+void SoftwareRenderer::renderStaticGeometry() {
+    for(const Box& box : m_staticBoxes) queueBox(box.low, box.high, box.color);
+}
+
+void SoftwareRenderer::clear(glm::vec3 color) {
+    m_clearColor = packColor(color);
+    m_clearRequested = true;
+}
+
+void SoftwareRenderer::present() {
+    m_triangles.clear();
+    for(std::vector<std::uint32_t>& bin : m_bins) bin.clear();
+
+    for(const Box& box : m_boxes) setupBox(box);
+
+    m_pool.parallelFor(m_bins.size(), [this](std::size_t tile) { rasterizeTile(tile); });
+
+    m_boxes.clear();
+    m_clearRequested = false;
+
+    blit();
+}
+
+void SoftwareRenderer::setProjectionMatrix(glm::mat4 projection) {
+    m_projection = projection;
+    m_viewProjection = m_projection * m_view;
+    m_frustum.update(m_viewProjection);
+}
+
+void SoftwareRenderer::setViewMatrix(glm::mat4 view) {
+    m_view = view;
+    m_viewProjection = m_projection * m_view;
+    m_frustum.update(m_viewProjection);
+    m_eye = glm::vec3(glm::inverse(view)[3]);
+}
+
+bool SoftwareRenderer::saveFrame(const std::string& path) const {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if(file == NULL) {
+        std::cout << "Unable to open " << path << " for the frame capture!\n";
+        return false;
+    }
+
+    std::vector<unsigned char> row(m_width * 3);
+    std::fprintf(file, "P6\n%d %d\n255\n", m_width, m_height);
+    for(int y = m_height - 1; y >= 0; y--) {
+        const std::uint32_t* pixels = &m_color[y * m_stride];
+        for(int x = 0; x < m_width; x++) {
+            row[x * 3 + 0] = pixels[x] & 0xFF;
+            row[x * 3 + 1] = (pixels[x] >> 8) & 0xFF;
+            row[x * 3 + 2] = (pixels[x] >> 16) & 0xFF;
+        }
+        std::fwrite(row.data(), 1, row.size(), file);
+    }
+    std::fclose(file);
+
+    return true;
+}
+
+void SoftwareRenderer::queueBox(const glm::vec3& low, const glm::vec3& high, const glm::vec3& color) {
+    if(!m_frustum.intersectsBox((low + high) * 0.5f, (high - low) * 0.5f)) return;
+    m_boxes.push_back(Box{ low, high, color });
+}
+
+// Only faces whose plane the camera is in front of can be seen, at most one per axis
+void SoftwareRenderer::setupBox(const Box& box) {
+    for(int axis = 0; axis < 3; axis++) {
+        float side;
+        if(m_eye[axis] < box.low[axis]) side = -1.0f;
+        else if(m_eye[axis] > box.high[axis]) side = 1.0f;
+        else continue;
+
+        int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        glm::vec3 corners[4];
+        for(int i = 0; i < 4; i++) {
+            corners[i][axis] = side < 0.0f ? box.low[axis] : box.high[axis];
+            corners[i][u] = (i == 1 || i == 2) ? box.high[u] : box.low[u];
+            corners[i][v] = (i >= 2) ? box.high[v] : box.low[v];
+        }
+
+        glm::vec3 normal(0.0f);
+        normal[axis] = side;
+        setupFace(corners, normal, box.color);
+    }
+}
+
+void SoftwareRenderer::setupFace(const glm::vec3 corners[4], const glm::vec3& normal, const glm::vec3& color) {
+    float diffuse = std::max(glm::dot(normal, LIGHT_DIRECTION), 0.0f);
+    std::uint32_t shaded = packColor(color * (AMBIENT + (1.0f - AMBIENT) * diffuse));
+
+    glm::vec4 clip[4];
+    for(int i = 0; i < 4; i++) clip[i] = m_viewProjection * glm::vec4(corners[i], 1.0f);
+
+    // Clip against the near plane (z > -w); the other planes are handled by the tile bounds and the depth test
+    glm::vec4 polygon[8];
+    int count = 0;
+    for(int i = 0; i < 4; i++) {
+        const glm::vec4& current = clip[i];
+        const glm::vec4& next = clip[(i + 1) % 4];
+        float currentDistance = current.z + current.w;
+        float nextDistance = next.z + next.w;
+
+        if(currentDistance >= 0.0f) polygon[count++] = current;
+        if((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+            polygon[count++] = current + (next - current) * (currentDistance / (currentDistance - nextDistance));
+        }
+    }
+    if(count < 3) return;
+
+    glm::vec3 window[8];
+    for(int i = 0; i < count; i++) {
+        glm::vec3 ndc = glm::vec3(polygon[i]) / polygon[i].w;
+        window[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * m_width, (ndc.y * 0.5f + 0.5f) * m_height, ndc.z * 0.5f + 0.5f);
+    }
+
+    for(int i = 1; i + 1 < count; i++) {
+        setupTriangle(window[0], window[i], window[i + 1], shaded);
+    }
+}
+
+void SoftwareRenderer::setupTriangle(const glm::vec3& v0, const glm::vec3& in1, const glm::vec3& in2, std::uint32_t color) {
+    float area = (in1.x - v0.x) * (in2.y - v0.y) - (in1.y - v0.y) * (in2.x - v0.x);
+    if(area == 0.0f) return;
+
+    // Faces are only set up when they face the camera, so the winding is fixed up instead of culled
+    const glm::vec3& v1 = area > 0.0f ? in1 : in2;
+    const glm::vec3& v2 = area > 0.0f ? in2 : in1;
+    area = std::fabs(area);
+
+    Triangle triangle;
+    triangle.color = color;
+    triangle.minX = std::max(0, (int)std::floor(std::min(v0.x, std::min(v1.x, v2.x))));
+    triangle.minY = std::max(0, (int)std::floor(std::min(v0.y, std::min(v1.y, v2.y))));
+    triangle.maxX = std::min(m_width - 1, (int)std::ceil(std::max(v0.x, std::max(v1.x, v2.x))));
+    triangle.maxY = std::min(m_height - 1, (int)std::ceil(std::max(v0.y, std::max(v1.y, v2.y))));
+    if(triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) return;
+
+    // Edge i runs from vertex i to vertex i + 1 and is positive on the inner side
+    const glm::vec3* vertices[3] = { &v0, &v1, &v2 };
+    for(int i = 0; i < 3; i++) {
+        const glm::vec3& from = *vertices[i];
+        const glm::vec3& to = *vertices[(i + 1) % 3];
+        triangle.edgeA[i] = from.y - to.y;
+        triangle.edgeB[i] = to.x - from.x;
+        triangle.edgeC[i] = -(triangle.edgeA[i] * from.x + triangle.edgeB[i] * from.y);
+
+        // Top-left rule, so pixels on an edge shared by two triangles are drawn once
+        triangle.edgeInclusive[i] = triangle.edgeA[i] > 0.0f || (triangle.edgeA[i] == 0.0f && triangle.edgeB[i] < 0.0f);
+    }
+
+    // Depth differences between nearby surfaces are tiny this far from the near plane, the gradients need doubles
+    double dx1 = v1.x - v0.x, dy1 = v1.y - v0.y, dz1 = v1.z - v0.z;
+    double dx2 = v2.x - v0.x, dy2 = v2.y - v0.y, dz2 = v2.z - v0.z;
+    double depthX = (dz1 * dy2 - dz2 * dy1) / area;
+    double depthY = (dz2 * dx1 - dz1 * dx2) / area;
+    triangle.depthA = depthX;
+    triangle.depthB = depthY;
+    triangle.depthC = v0.z - depthX * v0.x - depthY * v0.y;
+
+    std::uint32_t index = m_triangles.size();
+    m_triangles.push_back(triangle);
+
+    for(int tileY = triangle.minY / TILE_SIZE; tileY <= triangle.maxY / TILE_SIZE; tileY++) {
+        for(int tileX = triangle.minX / TILE_SIZE; tileX <= triangle.maxX / TILE_SIZE; tileX++) {
+            m_bins[tileY * m_tilesX + tileX].push_back(index);
+        }
+    }
+}
+
+// Triangles are drawn in submission order, so depth ties resolve like GL_LESS on the GPU
+void SoftwareRenderer::rasterizeTile(std::size_t tile) {
+    int x0 = (tile % m_tilesX) * TILE_SIZE;
+    int y0 = (tile / m_tilesX) * TILE_SIZE;
+    int x1 = std::min(x0 + TILE_SIZE, m_width);
+    int y1 = std::min(y0 + TILE_SIZE, m_height);
+
+    if(m_clearRequested) {
+        for(int y = y0; y < y1; y++) {
+            std::fill(&m_color[y * m_stride + x0], &m_color[y * m_stride + x1], m_clearColor);
+            std::fill(&m_depth[y * m_stride + x0], &m_depth[y * m_stride + x1], 1.0f);
+        }
+    }
+
+    for(std::uint32_t index : m_bins[tile]) {
+        const Triangle& triangle = m_triangles[index];
+        int fromX = std::max(x0, triangle.minX), toX = std::min(x1, triangle.maxX + 1);
+        int fromY = std::max(y0, triangle.minY), toY = std::min(y1, triangle.maxY + 1);
+
+        if(m_avx2) drawTriangleAVX2(triangle, fromX, fromY, toX, toY);
+        else drawTriangle(triangle, fromX, fromY, toX, toY);
+    }
+}
+
+// Steps start at a multiple of the SIMD width. Tiles are as well, so no step touches a pixel of another tile.
+void SoftwareRenderer::drawTriangle(const Triangle& t, int x0, int y0, int x1, int y1) {
+#ifdef SOFTWARE_RENDERER_X86
+    const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128i laneIndices = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i first = _mm_set1_epi32(x0 - 1), end = _mm_set1_epi32(x1);
+    const __m128i color = _mm_set1_epi32(t.color);
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 edgeA[3];
+    for(int i = 0; i < 3; i++) edgeA[i] = _mm_set1_ps(t.edgeA[i]);
+    const __m128 depthA = _mm_set1_ps(t.depthA);
+
+    for(int y = y0; y < y1; y++) {
+        float centerY = y + 0.5f;
+        __m128 edgeRow[3];
+        for(int i = 0; i < 3; i++) edgeRow[i] = _mm_set1_ps(t.edgeB[i] * centerY + t.edgeC[i]);
+        __m128 depthRow = _mm_set1_ps(t.depthB * centerY + t.depthC);
+
+        float* depthPixels = &m_depth[y * m_stride];
+        std::uint32_t* colorPixels = &m_color[y * m_stride];
+
+        for(int x = x0 & ~3; x < x1; x += 4) {
+            __m128 centerX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+            __m128i indices = _mm_add_epi32(_mm_set1_epi32(x), laneIndices);
+
+            __m128 mask = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(indices, first), _mm_cmplt_epi32(indices, end)));
+            for(int i = 0; i < 3; i++) {
+                __m128 edge = _mm_add_ps(_mm_mul_ps(edgeA[i], centerX), edgeRow[i]);
+                mask = _mm_and_ps(mask, t.edgeInclusive[i] ? _mm_cmpge_ps(edge, zero) : _mm_cmpgt_ps(edge, zero));
+            }
+            if(_mm_movemask_ps(mask) == 0) continue;
+
+            __m128 depth = _mm_add_ps(_mm_mul_ps(depthA, centerX), depthRow);
+            __m128 stored = _mm_loadu_ps(depthPixels + x);
+            mask = _mm_and_ps(mask, _mm_cmplt_ps(depth, stored));
+
+            _mm_storeu_ps(depthPixels + x, _mm_or_ps(_mm_and_ps(mask, depth), _mm_andnot_ps(mask, stored)));
+
+            __m128i colorMask = _mm_castps_si128(mask);
+            __m128i storedColor = _mm_loadu_si128((const __m128i*)(colorPixels + x));
+            _mm_storeu_si128((__m128i*)(colorPixels + x),
+                             _mm_or_si128(_mm_and_si128(colorMask, color), _mm_andnot_si128(colorMask, storedColor)));
+        }
+    }
+#else
+    for(int y = y0; y < y1; y++) {
+        float centerY = y + 0.5f;
+        for(int x = x0; x < x1; x++) {
+            float centerX = x + 0.5f;
+
+            bool inside = true;
+            for(int i = 0; i < 3; i++) {
+                float edge = t.edgeA[i] * centerX + t.edgeB[i] * centerY + t.edgeC[i];
+                inside = inside && (t.edgeInclusive[i] ? edge >= 0.0f : edge > 0.0f);
+            }
+            if(!inside) continue;
+
+            float depth = t.depthA * centerX + t.depthB * centerY + t.depthC;
+            if(depth < m_depth[y * m_stride + x]) {
+                m_depth[y * m_stride + x] = depth;
+                m_color[y * m_stride + x] = t.color;
+            }
+        }
+    }
+#endif
+}
+
+#ifdef SOFTWARE_RENDERER_X86
+__attribute__((target("avx2")))
+void SoftwareRenderer::drawTriangleAVX2(const Triangle& t, int x0, int y0, int x1, int y1) {
+    const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256i laneIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i first = _mm256_set1_epi32(x0 - 1), end = _mm256_set1_epi32(x1);
+    const __m256 color = _mm256_castsi256_ps(_mm256_set1_epi32(t.color));
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256 edgeA[3];
+    for(int i = 0; i < 3; i++) edgeA[i] = _mm256_set1_ps(t.edgeA[i]);
+    const __m256 depthA = _mm256_set1_ps(t.depthA);
+
+    for(int y = y0; y < y1; y++) {
+        float centerY = y + 0.5f;
+        __m256 edgeRow[3];
+        for(int i = 0; i < 3; i++) edgeRow[i] = _mm256_set1_ps(t.edgeB[i] * centerY + t.edgeC[i]);
+        __m256 depthRow = _mm256_set1_ps(t.depthB * centerY + t.depthC);
+
+        float* depthPixels = &m_depth[y * m_stride];
+        float* colorPixels = (float*)&m_color[y * m_stride];
+
+        for(int x = x0 & ~7; x < x1; x += 8) {
+            __m256 centerX = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+            __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(x), laneIndices);
+
+            __m256 mask = _mm256_castsi256_ps(_mm256_and_si256(_mm256_cmpgt_epi32(indices, first),
+                                                               _mm256_cmpgt_epi32(end, indices)));
+            for(int i = 0; i < 3; i++) {
+                __m256 edge = _mm256_add_ps(_mm256_mul_ps(edgeA[i], centerX), edgeRow[i]);
+                mask = _mm256_and_ps(mask, t.edgeInclusive[i] ? _mm256_cmp_ps(edge, zero, _CMP_GE_OQ)
+                                                               : _mm256_cmp_ps(edge, zero, _CMP_GT_OQ));
+            }
+            if(_mm256_movemask_ps(mask) == 0) continue;
+
+            __m256 depth = _mm256_add_ps(_mm256_mul_ps(depthA, centerX), depthRow);
+            __m256 stored = _mm256_loadu_ps(depthPixels + x);
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(depth, stored, _CMP_LT_OQ));
+
+            _mm256_storeu_ps(depthPixels + x, _mm256_blendv_ps(stored, depth, mask));
+            _mm256_storeu_ps(colorPixels + x, _mm256_blendv_ps(_mm256_loadu_ps(colorPixels + x), color, mask));
+        }
+    }
+}
+#else
+void SoftwareRenderer::drawTriangleAVX2(const Triangle& t, int x0, int y0, int x1, int y1) {
+    drawTriangle(t, x0, y0, x1, y1);
+}
+#endif
+
+void SoftwareRenderer::blit() {
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, m_stride);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, m_color.data());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLint readFramebuffer, viewport[4];
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBlitFramebuffer(0, 0, m_width, m_height, viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3],
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+}
@@ -0,0 +1,107 @@
+#ifndef SOFTWARERENDERER_H_INCLUDED
+#define SOFTWARERENDERER_H_INCLUDED
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "renderer.h"
+#include "frustum.h"
+#include "threadpool.h"
+
+// Rasterizes the boxes on the CPU. Every box only shows the up to three faces
+// turned to the camera, which are set up as flat shaded triangles and binned
+// into screen tiles; the tiles are then cleared and filled in parallel, with
+// 8 (AVX2) or 4 (SSE2) pixels per step. present() blits the finished frame
+// into the GL framebuffer bound for drawing, which only needs the GL context
+// for a texture upload.
+class SoftwareRenderer: public IRenderer {
+public:
+    static const int TILE_SIZE = 64;
+
+    // threadCount 0 uses every hardware thread
+    SoftwareRenderer(int width, int height, unsigned threadCount = 0);
+    ~SoftwareRenderer();
+
+    void renderWrappedBox(glm::vec3 position, glm::vec3 color, glm::vec3 size);
+    void renderBox(glm::vec3 position, glm::vec3 color, glm::vec3 size);
+
+    StaticBoxID addStaticBox(glm::vec3 position, glm::vec3 color, glm::vec3 size);
+    void updateStaticBox(StaticBoxID id, glm::vec3 position, glm::vec3 color, glm::vec3 size);
+    void clearStaticGeometry();
+    void renderStaticGeometry();
+
+    void beginFrame() { }
+    void clear(glm::vec3 color);
+    void setPass(GpuPass pass) { }
+    void present();
+
+    void setProjectionMatrix(glm::mat4 projection);
+    void setViewMatrix(glm::mat4 view);
+
+    // Writes the last presented frame as a binary PPM
+    bool saveFrame(const std::string& path) const;
+
+    // RGBA8, bottom row first, getStride() pixels per row
+    const std::uint32_t* getPixels() const { return m_color.data(); }
+    int getStride() const { return m_stride; }
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+
+    const char* getInstructionSet() const { return m_avx2 ? "AVX2" : "SSE2"; }
+    unsigned getThreadCount() const { return m_pool.getThreadCount(); }
+
+private:
+    struct Box {
+        glm::vec3 low, high;
+        glm::vec3 color;
+    };
+
+    // Edge functions and depth are planes a * x + b * y + c in window coordinates
+    struct Triangle {
+        float edgeA[3], edgeB[3], edgeC[3];
+        bool edgeInclusive[3]; // pixel centers exactly on the edge belong to the triangle
+        float depthA, depthB, depthC;
+        std::uint32_t color;
+        int minX, minY, maxX, maxY;
+    };
+
+    void queueBox(const glm::vec3& low, const glm::vec3& high, const glm::vec3& color);
+    void setupBox(const Box& box);
+    void setupFace(const glm::vec3 corners[4], const glm::vec3& normal, const glm::vec3& color);
+    void setupTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, std::uint32_t color);
+
+    void rasterizeTile(std::size_t tile);
+    void drawTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1);
+    void drawTriangleAVX2(const Triangle& triangle, int x0, int y0, int x1, int y1);
+
+    void blit();
+
+    int m_width, m_height, m_stride;
+    int m_tilesX, m_tilesY;
+    bool m_avx2;
+
+    std::vector<std::uint32_t> m_color;
+    std::vector<float> m_depth;
+    std::uint32_t m_clearColor;
+    bool m_clearRequested;
+
+    glm::mat4 m_projection, m_view, m_viewProjection;
+    glm::vec3 m_eye;
+    Frustum m_frustum;
+
+    std::vector<Box> m_boxes;
+    std::vector<Box> m_staticBoxes;
+    std::vector<Triangle> m_triangles;
+    std::vector<std::vector<std::uint32_t>> m_bins;
+
+    ThreadPool m_pool;
+
+    GLuint m_texture;
+    GLuint m_framebuffer;
+};
+
+#endif // SOFTWARERENDERER_H_INCLUDED
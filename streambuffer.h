@@ -0,0 +1,189 @@
+#ifndef STREAMBUFFER_H_INCLUDED
+#define STREAMBUFFER_H_INCLUDED
+
+#include <glad/glad.h>
+#include <chrono>
+
+#include "glextensions.h"
+
+struct StreamBufferStats {
+    unsigned long frames = 0;
+    unsigned long fenceWaits = 0;
+    unsigned long reallocations = 0;
+    double fenceWaitTime = 0.0;
+};
+
+// Ring of FRAME_COUNT regions inside one buffer object. The CPU writes the
+// current region while the GPU may still read the previous ones; each region
+// is guarded by a fence placed after the draws that used it.
+class StreamBuffer {
+public:
+    static const int FRAME_COUNT = 3;
+
+    StreamBuffer(GLenum target, std::size_t frameSize):
+        m_target(target), m_buffer(0), m_frameSize(0), m_frame(0), m_mapped(NULL) {
+
+        m_persistent = GLExtensions::ARB_buffer_storage;
+        for(int i = 0; i < FRAME_COUNT; i++) m_fences[i] = 0;
+
+        allocate(frameSize);
+    }
+
+    ~StreamBuffer() {
+        release();
+    }
+
+    // Waits until the GPU is done with the current region and returns a pointer offset bytes into it.
+    // Mapping again after unmap() in the same frame only covers the bytes past offset, so data that
+    // earlier draws of the frame read stays intact.
+    void* map(std::size_t offset) {
+        waitForFence(m_frame);
+
+        if(m_persistent) {
+            m_mapped = m_base + getFrameOffset() + offset;
+        } else {
+            glBindBuffer(m_target, m_buffer);
+            m_mapped = (char*)glMapBufferRange(m_target, getFrameOffset() + offset, m_frameSize - offset,
+                                               GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+            glBindBuffer(m_target, 0);
+        }
+
+        return m_mapped;
+    }
+
+    // Reallocates with a frame region of frameSize, keeping the first usedBytes of the current region.
+    // Returns the new mapping at usedBytes.
+    void* grow(std::size_t frameSize, std::size_t usedBytes) {
+        GLuint oldBuffer = m_buffer;
+        std::size_t oldOffset = getFrameOffset();
+
+        if(!m_persistent && m_mapped != NULL) {
+            glBindBuffer(m_target, oldBuffer);
+            glUnmapBuffer(m_target);
+        }
+
+        for(int i = 0; i < FRAME_COUNT; i++) {
+            if(m_fences[i] != 0) glDeleteSync(m_fences[i]);
+            m_fences[i] = 0;
+        }
+
+        m_buffer = 0;
+        allocate(frameSize);
+        m_stats.reallocations++;
+
+        glBindBuffer(GL_COPY_READ_BUFFER, oldBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, oldOffset, getFrameOffset(), usedBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        glDeleteBuffers(1, &oldBuffer);
+
+        return map(usedBytes);
+    }
+
+    // Makes the written data visible to the GPU; call before drawing from the region
+    void unmap() {
+        if(m_mapped == NULL) return;
+
+        if(!m_persistent) {
+            glBindBuffer(m_target, m_buffer);
+            glUnmapBuffer(m_target);
+            glBindBuffer(m_target, 0);
+        }
+
+        m_mapped = NULL;
+    }
+
+    // Call after the last draw reading the current region
+    void fence() {
+        unmap();
+
+        if(m_fences[m_frame] != 0) glDeleteSync(m_fences[m_frame]);
+        m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        m_frame = (m_frame + 1) % FRAME_COUNT;
+        m_stats.frames++;
+    }
+
+    GLuint getBufferID() const { return m_buffer; }
+    std::size_t getFrameSize() const { return m_frameSize; }
+    std::size_t getFrameOffset() const { return m_frame * m_frameSize; }
+    bool isPersistent() const { return m_persistent; }
+    bool isMapped() const { return m_mapped != NULL; }
+
+    const StreamBufferStats& getStats() const { return m_stats; }
+
+private:
+    void allocate(std::size_t frameSize) {
+        m_frameSize = frameSize;
+        m_frame = 0;
+        m_base = NULL;
+
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(m_target, m_buffer);
+
+        if(m_persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            GLExtensions::glBufferStorage(m_target, m_frameSize * FRAME_COUNT, NULL, flags);
+            m_base = (char*)glMapBufferRange(m_target, 0, m_frameSize * FRAME_COUNT, flags);
+        } else {
+            glBufferData(m_target, m_frameSize * FRAME_COUNT, NULL, GL_STREAM_DRAW);
+        }
+
+        glBindBuffer(m_target, 0);
+    }
+
+    void release() {
+        for(int i = 0; i < FRAME_COUNT; i++) {
+            if(m_fences[i] != 0) glDeleteSync(m_fences[i]);
+            m_fences[i] = 0;
+        }
+
+        if(m_buffer != 0) {
+            if(m_persistent || m_mapped != NULL) {
+                glBindBuffer(m_target, m_buffer);
+                glUnmapBuffer(m_target);
+                glBindBuffer(m_target, 0);
+            }
+            glDeleteBuffers(1, &m_buffer);
+        }
+
+        m_buffer = 0;
+        m_mapped = NULL;
+    }
+
+    void waitForFence(int frame) {
+        GLsync sync = m_fences[frame];
+        if(sync == 0) return;
+
+        GLenum status = glClientWaitSync(sync, 0, 0);
+        if(status == GL_TIMEOUT_EXPIRED) {
+            auto start = std::chrono::steady_clock::now();
+            m_stats.fenceWaits++;
+
+            do {
+                status = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            } while(status == GL_TIMEOUT_EXPIRED);
+
+            m_stats.fenceWaitTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        glDeleteSync(sync);
+        m_fences[frame] = 0;
+    }
+
+    GLenum m_target;
+    GLuint m_buffer;
+    std::size_t m_frameSize;
+    int m_frame;
+
+    bool m_persistent;
+    char* m_base;
+    char* m_mapped;
+
+    GLsync m_fences[FRAME_COUNT];
+    StreamBufferStats m_stats;
+};
+
+#endif // STREAMBUFFER_H_INCLUDED
@@ -4,184 +4,269 @@
 #include "common.h"
 #include "renderer.h"
 #include "components.h"
+#include "simulation.h"
+#include "latencytracer.h"
+#include "occupancygrid.h"
+#include "snakemesher.h"
 #include "3rdparty/entt.hpp"
 
-#include <stdexcept>
-
-constexpr const float LAG_TIME = 0.3f;
-constexpr float SPEED = 1.0f / LAG_TIME;
-
-class ISystem {
-public:
-    virtual ~ISystem() { }
-    virtual void update(entt::registry& registry, entt::dispatcher& dispatcher, double delta) { }
-    virtual void draw(entt::registry& registry, entt::dispatcher& dispatcher) { }
-    virtual void processInput(entt::registry& registry, entt::dispatcher& dispatcher, GLFWwindow* window) { }
+#include <atomic>
+#include <deque>
+
+// Everything the renderer reads from the simulation for one frame
+struct RenderSnapshot {
+    unsigned long sequence = 0;
+
+    // The snake body as changes to what the renderer already has: the segments in snakeDirty, with
+    // their positions in snakeDirtySegments range after range, and snakeShifts SegmentChanges::shift
+    // calls in total
+    unsigned long snakeShifts = 0;
+    std::size_t snakeLength = 0;
+    std::vector<IndexRange> snakeDirty;
+    std::vector<glm::vec3> snakeDirtySegments;
+
+    // Over a tick the head slides from its last cell into the current one, and the segment the tail
+    // left from there into the tail's cell; the rest of the body stays on its cells
+    glm::vec3 snakeHeadFrom, snakeHeadTo;
+    glm::vec3 snakeTailFrom, snakeTailTo;
+    bool hasSnake = false;
+
+    // Seconds into the current tick when captured, and when that was on the context's clock
+    double tickProgress = 0.0;
+    double captureTime = 0.0;
+
+    std::vector<glm::vec3> apples;
+    InputTrace lastTurn;
 };
 
 class RenderingSystem: public ISystem {
 public:
-    RenderingSystem() {
+    // Takes ownership of renderer
+    explicit RenderingSystem(IRenderer* renderer): m_renderer(renderer), m_capturedSequence(0), m_snakeShifts(0), m_drawnSequence(0) {
 
-        m_renderer.setProjectionMatrix(glm::perspective(45.0f, Constants::SCREEN_WIDTH/Constants::SCREEN_HEIGHT, 0.1f, 100.0f));
-        m_renderer.setViewMatrix(glm::lookAt(glm::vec3(0.0f, 8.0f, 10.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        m_renderer->setProjectionMatrix(glm::perspective(45.0f, Constants::SCREEN_WIDTH/Constants::SCREEN_HEIGHT, 0.1f, 100.0f));
+        m_renderer->setViewMatrix(glm::lookAt(glm::vec3(0.0f, 8.0f, 10.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
 
+        m_renderer->addStaticBox(glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(2.0f * Constants::BOARD_WIDTH, 1.0f, 2.0f * Constants::BOARD_HEIGHT));
     }
-    void draw(entt::registry& registry, entt::dispatcher& dispatcher) {
-        auto snakeView = registry.view<Snake>();
-        snakeView.each([&](entt::entity snake, Snake& snakeComponent){
-            if(!snakeComponent.parts.empty()) {
-                for(std::size_t i = 0; i < snakeComponent.parts.size(); i++) {
-                    m_renderer.renderCube(snakeComponent.parts[i], glm::vec3(1.0f, 0.7f, 0.0f));
-                }
-
-                m_renderer.renderCube(snakeComponent.parts[1] + directionToVector(snakeComponent.movingDirection) * 0.1f, glm::vec3(1.0f, 0.7f, 0.0f));
-                m_renderer.setViewMatrix(glm::lookAt(glm::vec3(0.0f, 8.0f, 10.0f), snakeComponent.parts[0], glm::vec3(0.0f, 1.0f, 0.0f)));
+    // Copies what draw() needs out of the registry; runs on the simulation thread. Takes the snake's
+    // changes, there is one snake.
+    void capture(entt::registry& registry, RenderSnapshot& snapshot) {
+        snapshot.sequence = ++m_capturedSequence;
+        snapshot.snakeLength = 0;
+        snapshot.snakeDirty.clear();
+        snapshot.snakeDirtySegments.clear();
+        snapshot.apples.clear();
+        snapshot.hasSnake = false;
+
+        // The render thread may skip snapshots, so every snapshot carries the changes since the last
+        // one it drew. Drawing a change twice is harmless, shifts are counted from the start.
+        unsigned long drawnSequence = m_drawnSequence.load(std::memory_order_acquire);
+        while(!m_pendingChanges.empty() && m_pendingChanges.front().sequence <= drawnSequence) m_pendingChanges.pop_front();
+
+        registry.view<Snake>().each([&](entt::entity snake, Snake& snakeComponent) {
+            m_snakeShifts += snakeComponent.changes.shifts;
+            m_pendingChanges.push_back(PendingChanges{snapshot.sequence, snakeComponent.changes});
+            snakeComponent.changes.clear();
+
+            const SnakeBody& parts = snakeComponent.parts;
+            snapshot.snakeLength = parts.size();
+            if(!parts.empty()) {
+                snapshot.snakeHeadFrom = toPosition(parts[1]);
+                snapshot.snakeHeadTo = toPosition(parts[0]);
+                snapshot.snakeTailFrom = toPosition(snakeComponent.previousTail);
+                snapshot.snakeTailTo = toPosition(parts[parts.size() - 1]);
+                snapshot.hasSnake = true;
             }
         });
 
-        registry.view<Apple>().each([&](entt::entity apple, Apple& appleComponent) {
-            m_renderer.renderCube(appleComponent.position, glm::vec3(1.0f, 0.0f, 0.0f));
-        });
+        m_unseenChanges.clear();
+        for(const PendingChanges& pending : m_pendingChanges) m_unseenChanges.append(pending.changes);
 
-        m_renderer.renderBox(glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(2.0f * Constants::BOARD_WIDTH, 1.0f, 2.0f * Constants::BOARD_HEIGHT));
+        snapshot.snakeShifts = m_snakeShifts;
+        registry.view<Snake>().each([&](entt::entity snake, Snake& snakeComponent) {
+            for(IndexRange range : m_unseenChanges.dirty) {
+                if(range.first >= snakeComponent.parts.size()) break;
+                range.last = std::min(range.last, snakeComponent.parts.size() - 1);
+                snapshot.snakeDirty.push_back(range);
 
-        m_renderer.present();
-    }
-
-private:
-    Renderer m_renderer;
-};
-
-class AppleSpawningSystem: public ISystem {
-public:
-    void update(entt::registry& registry, entt::dispatcher& dispatcher, double delta) {
-        auto appleView = registry.view<Apple>();
-        if(appleView.size() < Constants::MAX_APPLES_COUNT) {
-            if(drand48() * 100.0f < Constants::APPLE_SPAWN_CHANCE) {
-                float randX = std::round( (drand48() - drand48()) * Constants::BOARD_WIDTH);
-                float randZ = std::round( (drand48() - drand48()) * Constants::BOARD_HEIGHT);
-
-                auto apple = registry.create();
-                registry.assign<Apple>(apple, glm::vec3(randX, 0.0f, randZ));
+                SnakeBodySpan spans[2];
+                std::size_t spanCount = snakeComponent.parts.getSpans(range, spans);
+                for(std::size_t i = 0; i < spanCount; i++) {
+                    for(std::size_t j = 0; j < spans[i].size; j++) snapshot.snakeDirtySegments.push_back(toPosition(spans[i].data[j]));
+                }
             }
-        }
+        });
 
+        registry.view<Apple>().each([&](entt::entity apple, Apple& appleComponent) {
+            snapshot.apples.push_back(appleComponent.position);
+        });
     }
-};
 
-class MovingSystem: public ISystem {
-public:
-    MovingSystem(): m_previousDirection(0.0f, 0.0f, 0.0f) { }
-    void update(entt::registry& registry, entt::dispatcher& dispatcher, double delta) {
-        m_elapsedTime += delta;
-        auto snakeView = registry.view<Snake>();
-        snakeView.each([&](entt::entity snake, Snake& snakeComponent) {
-            auto& parts = snakeComponent.parts;
-            if(m_elapsedTime > LAG_TIME) {
+    // Needs nothing but the snapshot, so it can run on the thread owning the GL context. time is now on
+    // the context's clock, how far into the tick to draw the snake follows from it.
+    void draw(const RenderSnapshot& snapshot, double time) {
+        m_renderer->beginFrame();
+        m_renderer->clear(glm::vec3(0.73f, 0.88f, 0.98f));
 
-                for(std::size_t i = 1; i < parts.size(); ++i) {
-                    if(glm::distance(parts[0], parts[i]) < 0.1f)
-                        throw std::logic_error("You lose!");
-                }
+        float progress = (float)glm::clamp((snapshot.tickProgress + time - snapshot.captureTime) / TICK_TIME, 0.0, 1.0);
+        glm::vec3 head = slide(snapshot.snakeHeadFrom, snapshot.snakeHeadTo, progress);
+        if(snapshot.hasSnake) {
+            m_renderer->setViewMatrix(glm::lookAt(glm::vec3(0.0f, 8.0f, 10.0f), head, glm::vec3(0.0f, 1.0f, 0.0f)));
+        }
 
-                for(std::size_t i = parts.size() - 1; i > 0; i--) {
-                    parts[i] = glm::round(parts[i - 1]);
-                }
+        // The snapshot only has cells. The head is drawn between its last two, and one more segment
+        // behind the tail between the tail's last two.
+        std::size_t length = snapshot.hasSnake ? snapshot.snakeLength + 1 : 0;
+        m_frameDirty = snapshot.snakeDirty;
+        m_frameSegments.clear();
+        if(snapshot.hasSnake) {
+            addIndexRange(m_frameDirty, IndexRange{0, 0});
+            addIndexRange(m_frameDirty, IndexRange{length - 1, length - 1});
+        }
 
-                vector<entt::entity> collidedApples;
-                registry.view<Apple>().each([&](entt::entity apple, Apple& appleComponent) {
-                    if(glm::distance(parts[0], appleComponent.position) < 0.1f) {
-                        collidedApples.push_back(apple);
-                        parts.push_back(parts.back());
-                        //trigger event
+        std::size_t source = 0, sourceOffset = 0;
+        for(const IndexRange& range : m_frameDirty) {
+            for(std::size_t i = range.first; i <= range.last; i++) {
+                if(i == 0) {
+                    m_frameSegments.push_back(head);
+                } else if(i == length - 1) {
+                    m_frameSegments.push_back(slide(snapshot.snakeTailFrom, snapshot.snakeTailTo, progress));
+                } else {
+                    while(snapshot.snakeDirty[source].last < i) {
+                        sourceOffset += snapshot.snakeDirty[source].last - snapshot.snakeDirty[source].first + 1;
+                        source++;
                     }
-                });
-
-                for(auto apple : collidedApples)
-                    registry.destroy(apple);
-
-                m_elapsedTime = 0.0f;
-                snakeComponent.parts[0] = glm::round(snakeComponent.parts[0]);
+                    m_frameSegments.push_back(snapshot.snakeDirtySegments[sourceOffset + i - snapshot.snakeDirty[source].first]);
+                }
             }
+        }
 
+        m_snakeMesher.update(snapshot.snakeShifts, length, m_frameDirty, m_frameSegments.data());
+        m_drawnSequence.store(snapshot.sequence, std::memory_order_release);
 
-            parts[0] += directionToVector(snakeComponent.movingDirection) * float(delta) * SPEED;
-            parts[0] = wrapPosition(parts[0]);
-
-            glm::vec3 target = snakeComponent.parts[parts.size() - 2];
-            glm::vec3 position = snakeComponent.parts[parts.size() - 1];
+        m_renderer->setPass(PASS_SNAKE);
+        m_renderer->renderSnake(m_snakeMesher.getView(), glm::vec3(1.0f, 0.7f, 0.0f));
+        m_snakeMesher.clearDirty();
+        if(snapshot.hasSnake) {
+            m_renderer->renderCube(slide(snapshot.snakeHeadFrom, snapshot.snakeHeadTo, 0.1f), glm::vec3(1.0f, 0.7f, 0.0f));
+        }
 
-            glm::vec3 direction = glm::normalize(target - position);
+        m_renderer->setPass(PASS_APPLES);
+        for(const glm::vec3& apple : snapshot.apples) {
+            m_renderer->renderCube(apple, glm::vec3(1.0f, 0.0f, 0.0f));
+        }
 
-            if(glm::distance(target, position) > 2.0f) {
-                direction = m_previousDirection;
-            }
+        m_renderer->setPass(PASS_BOARD);
+        m_renderer->renderStaticGeometry();
 
+        m_renderer->present();
+    }
 
-            m_previousDirection = direction;
+    ~RenderingSystem() {
+        delete m_renderer;
+    }
 
-            parts[parts.size() - 1] += direction * float(delta) * SPEED;
-            parts[parts.size() - 1] = wrapPosition(parts[parts.size() - 1]);
-        });
+    IRenderer& getRenderer() {
+        return *m_renderer;
+    }
 
+    SnakeMesher& getSnakeMesher() {
+        return m_snakeMesher;
     }
+
 private:
-    glm::vec3 m_previousDirection;
+    static glm::vec3 toPosition(glm::ivec3 cell) {
+        return glm::vec3(cell) * Constants::CELL_WIDTH;
+    }
 
-    glm::vec3 wrapPosition(glm::vec3 position) {
-        float size = Constants::CELL_WIDTH * 0.5f;
+    // Part of the way from one cell to the next; across the board edge that is the short way, off the
+    // board and back in from the other side
+    static glm::vec3 slide(glm::vec3 from, glm::vec3 to, float progress) {
+        glm::vec3 step = to - from;
+        if(step.x > Constants::BOARD_WIDTH) step.x -= 2.0f * Constants::BOARD_WIDTH;
+        else if(step.x < -Constants::BOARD_WIDTH) step.x += 2.0f * Constants::BOARD_WIDTH;
+        if(step.z > Constants::BOARD_HEIGHT) step.z -= 2.0f * Constants::BOARD_HEIGHT;
+        else if(step.z < -Constants::BOARD_HEIGHT) step.z += 2.0f * Constants::BOARD_HEIGHT;
 
-        if(position.x < -Constants::BOARD_WIDTH - size) position.x = Constants::BOARD_WIDTH - size - (-Constants::BOARD_WIDTH - size - position.x);
-        else if(position.x > Constants::BOARD_WIDTH + size) position.x = -Constants::BOARD_WIDTH + size + (position.x - Constants::BOARD_WIDTH - size);
+        return from + step * progress;
+    }
 
-        if(position.z < -Constants::BOARD_HEIGHT - size) position.z = Constants::BOARD_HEIGHT - size - (-Constants::BOARD_HEIGHT - size - position.z);
-        else if(position.z > Constants::BOARD_HEIGHT + size) position.z = -Constants::BOARD_HEIGHT + size + (position.z - Constants::BOARD_HEIGHT - size);
+    struct PendingChanges {
+        unsigned long sequence;
+        SegmentChanges changes;
+    };
 
-        return position;
-    }
+    IRenderer* m_renderer;
+
+    // Simulation thread
+    unsigned long m_capturedSequence;
+    std::deque<PendingChanges> m_pendingChanges;
+    SegmentChanges m_unseenChanges;
+    unsigned long m_snakeShifts;
 
-    double m_elapsedTime;
+    // Render thread
+    std::atomic<unsigned long> m_drawnSequence;
+    SnakeMesher m_snakeMesher;
+    std::vector<IndexRange> m_frameDirty;
+    std::vector<glm::vec3> m_frameSegments;
 };
 
 class InputProcessingSystem: public ISystem {
 public:
-    InputProcessingSystem(): m_elapsedTime(0.0), m_nextDirection(LEFT) { }
+    InputProcessingSystem(): m_nextDirection(LEFT), m_latencyTracer(NULL) { }
+
+    // Turns are reported to tracer when set, NULL stops tracing
+    void setLatencyTracer(LatencyTracer* tracer) {
+        m_latencyTracer = tracer;
+    }
 
+    // The last direction asked for is taken once a tick, right before the snake moves
     void update(entt::registry& registry, entt::dispatcher& dispatcher, double delta) {
-        m_elapsedTime += delta;
-        if(m_elapsedTime > LAG_TIME) {
-            auto snakeView = registry.view<Snake>();
-            snakeView.each([&](entt::entity snake, Snake& snakeComponent) {
-                snakeComponent.movingDirection = m_nextDirection;
-            });
-
-            m_elapsedTime = 0.0;
-        }
+        auto snakeView = registry.view<Snake>();
+        snakeView.each([&](entt::entity snake, Snake& snakeComponent) {
+            if(m_latencyTracer != NULL && snakeComponent.movingDirection != m_nextDirection) m_latencyTracer->turnApplied();
+            snakeComponent.movingDirection = m_nextDirection;
+        });
     }
 
     void processInput(entt::registry& registry, entt::dispatcher& dispatcher, GLFWwindow* window) {
         auto snakeView = registry.view<Snake>(); //registry.view<Snake, PlayerConfiguration>();
         snakeView.each([&](entt::entity snake, Snake& snakeComponent) {
             if(glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS && snakeComponent.movingDirection != BOTTOM) {
-                m_nextDirection = TOP;
+                setNextDirection(snakeComponent, TOP, GLFW_KEY_W);
             } else if(glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS && snakeComponent.movingDirection != TOP) {
-                m_nextDirection = BOTTOM;
+                setNextDirection(snakeComponent, BOTTOM, GLFW_KEY_S);
             } else if(glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS && snakeComponent.movingDirection != LEFT) {
-                m_nextDirection = RIGHT;
+                setNextDirection(snakeComponent, RIGHT, GLFW_KEY_A);
             } else if(glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS && snakeComponent.movingDirection != RIGHT) {
-                m_nextDirection = LEFT;
+                setNextDirection(snakeComponent, LEFT, GLFW_KEY_D);
             }
 
             if(glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
-                snakeComponent.parts.push_back(snakeComponent.parts.back());
+                snakeComponent.grow();
             }
 
         });
     }
+    // Turns the snake a quarter to the side as if a key had been pressed just now, for runs without a window
+    void injectTurn(entt::registry& registry) {
+        registry.view<Snake>().each([&](entt::entity snake, Snake& snakeComponent) {
+            Direction turn = (snakeComponent.movingDirection == LEFT || snakeComponent.movingDirection == RIGHT) ? TOP : LEFT;
+            setNextDirection(snakeComponent, turn, -1);
+        });
+    }
+
 private:
-    double m_elapsedTime;
+    void setNextDirection(const Snake& snakeComponent, Direction direction, int key) {
+        if(m_latencyTracer != NULL && direction != m_nextDirection && direction != snakeComponent.movingDirection) {
+            m_latencyTracer->turnRequested(key >= 0 ? m_latencyTracer->getKeyTime(key) : LatencyTracer::now());
+        }
+        m_nextDirection = direction;
+    }
+
     Direction m_nextDirection;
+    LatencyTracer* m_latencyTracer;
 };
 
 
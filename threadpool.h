@@ -0,0 +1,105 @@
+#ifndef THREADPOOL_H_INCLUDED
+#define THREADPOOL_H_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers for fork-join loops. The thread calling parallelFor
+// works on the loop as well, so a pool of one thread has no workers at all.
+class ThreadPool {
+public:
+    // 0 uses one thread per hardware thread
+    explicit ThreadPool(unsigned threadCount = 0):
+        m_job(NULL), m_count(0), m_next(0), m_busy(0), m_generation(0), m_stopping(false) {
+
+        if(threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+        for(unsigned i = 1; i < threadCount; i++) {
+            m_threads.push_back(std::thread(&ThreadPool::work, this));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_start.notify_all();
+
+        for(std::thread& thread : m_threads) thread.join();
+    }
+
+    // Calls job(i) for every i in [0, count) in no particular order and returns once all calls are done
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& job) {
+        if(m_threads.empty()) {
+            for(std::size_t i = 0; i < count; i++) job(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job = &job;
+            m_count = count;
+            m_next = 0;
+            m_busy = m_threads.size();
+            m_generation++;
+        }
+        m_start.notify_all();
+
+        runJobs(job, count);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_busy == 0; });
+        m_job = NULL;
+    }
+
+    unsigned getThreadCount() const { return m_threads.size() + 1; }
+
+private:
+    void work() {
+        unsigned long seenGeneration = 0;
+
+        while(true) {
+            const std::function<void(std::size_t)>* job;
+            std::size_t count;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start.wait(lock, [&] { return m_stopping || m_generation != seenGeneration; });
+                if(m_stopping) return;
+
+                seenGeneration = m_generation;
+                job = m_job;
+                count = m_count;
+            }
+
+            runJobs(*job, count);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(--m_busy == 0) m_done.notify_one();
+        }
+    }
+
+    void runJobs(const std::function<void(std::size_t)>& job, std::size_t count) {
+        for(std::size_t i = m_next++; i < count; i = m_next++) job(i);
+    }
+
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+
+    const std::function<void(std::size_t)>* m_job;
+    std::size_t m_count;
+    std::atomic<std::size_t> m_next;
+    std::size_t m_busy;
+    unsigned long m_generation;
+    bool m_stopping;
+};
+
+#endif // THREADPOOL_H_INCLUDED
@@ -0,0 +1,48 @@
+#ifndef TRIPLEBUFFER_H_INCLUDED
+#define TRIPLEBUFFER_H_INCLUDED
+
+#include <atomic>
+
+// Single producer, single consumer hand-off of the latest value. The writer
+// fills the back slot and publishes it, the reader takes whatever was
+// published last; neither waits for the other, the reader simply skips
+// values that were overwritten before it got to them. Slots are reused, so
+// containers inside T keep their capacity.
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer(): m_back(0), m_middle(1), m_front(2) { }
+
+    T& getBack() { return m_slots[m_back].value; }
+
+    void publish() {
+        m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Returns false and keeps the previous value when nothing new was published
+    bool acquire() {
+        if((m_middle.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& getFront() const { return m_slots[m_front].value; }
+
+private:
+    static const int INDEX = 3;
+    static const int FRESH = 4;
+
+    // Writer and reader work on different slots, keep them off each other's cache lines
+    struct alignas(64) Slot {
+        T value;
+    };
+
+    Slot m_slots[3];
+
+    alignas(64) int m_back;
+    alignas(64) std::atomic<int> m_middle;
+    alignas(64) int m_front;
+};
+
+#endif // TRIPLEBUFFER_H_INCLUDED